@@ -1,6 +1,6 @@
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent network
 
 CONFIG += c++17
 
@@ -9,13 +9,25 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    capturelane.cpp \
+    capturepublisher.cpp \
+    eventio.cpp \
+    heatmap.cpp \
     main.cpp \
     mainwindow.cpp \
-    scribbler.cpp
+    overview.cpp \
+    scribbler.cpp \
+    similarity.cpp
 
 HEADERS += \
+    capturelane.h \
+    capturepublisher.h \
+    eventio.h \
+    heatmap.h \
     mainwindow.h \
-    scribbler.h
+    overview.h \
+    scribbler.h \
+    similarity.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -0,0 +1,105 @@
+#include "capturelane.h"
+#include "scribbler.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <math.h>
+
+CaptureLane::CaptureLane()
+    : contactKey(0), active(false), prevTimestamp(0), preview(nullptr) {}
+
+// no-op once done: clear() keeps the capacity
+void CaptureLane::reserve() {
+    samples.reserve(capacity);
+}
+
+bool CaptureLane::press(quint64 _contactKey, QPointF p, quint64 time, float pressure) {
+    // room for this Press and the Release that must follow it
+    if (samples.size() + 2 > capacity) return false;
+
+    contactKey = _contactKey;
+    active = true;
+    lastPoint = p;
+    prevTimestamp = time;
+
+    samples.append(LaneSample{MouseEvent::Press, p, time, 0.0f, 0.0f, pressure});
+    if (preview) preview->sampleAdded();
+    return true;
+}
+
+/* Same kinematics as Scribbler's mouse handlers, kept per contact */
+bool CaptureLane::move(QPointF p, quint64 time, float pressure) {
+    // the last slot is the Release's
+    if (samples.size() + 2 > capacity) return false;
+
+    float distance = sqrt(pow(p.x() - lastPoint.x(), 2.0) + pow(p.y() - lastPoint.y(), 2.0));
+    float timeDiff = (float)(time - prevTimestamp);
+    if (timeDiff == 0) timeDiff = 1; //prevent zero division
+    float speed = distance / timeDiff;
+    lastPoint = p;
+    prevTimestamp = time;
+
+    samples.append(LaneSample{MouseEvent::Move, p, time, distance, speed, pressure});
+    if (preview) preview->sampleAdded();
+    return true;
+}
+
+void CaptureLane::release(QPointF p, quint64 time, float pressure) {
+    float distance = sqrt(pow(p.x() - lastPoint.x(), 2.0) + pow(p.y() - lastPoint.y(), 2.0));
+    float timeDiff = (float)(time - prevTimestamp);
+    if (timeDiff == 0) timeDiff = 1; //prevent zero division
+    float speed = distance / timeDiff;
+    active = false;
+
+    samples.append(LaneSample{MouseEvent::Release, p, time, distance, speed, pressure});
+}
+
+void CaptureLane::clear() {
+    // resize keeps the reserved capacity, clear() may give it back
+    samples.resize(0);
+    if (preview) preview->update();
+}
+
+LanePreview::LanePreview(const CaptureLane &_lane, QRectF _area, double _lineWidth)
+    : lane(_lane), area(_area), lineWidth(_lineWidth) {
+    // exposedRect lets paint skip segments outside the region being repainted
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+}
+
+QRectF LanePreview::boundingRect() const {
+    return area;
+}
+
+void LanePreview::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) {
+    Q_UNUSED(widget);
+
+    // dots at every sample, lines between samples of the same stroke; width follows pressure
+    if (lane.samples.isEmpty()) return;
+    painter->setBrush(Qt::black);
+    QPointF from = lane.samples.first().pos;
+    for (const LaneSample &sample : lane.samples) {
+        double width = lineWidth * sample.pressure;
+        QRectF segment = QRectF(from, sample.pos).normalized().adjusted(-width, -width, width, width);
+        if (!option->exposedRect.intersects(segment)) {
+            if (sample.action != MouseEvent::Release) from = sample.pos;
+            continue;
+        }
+        if (sample.action == MouseEvent::Move) {
+            painter->setPen(QPen(Qt::black, width, Qt::SolidLine, Qt::FlatCap));
+            painter->drawLine(from, sample.pos);
+        }
+        if (sample.action != MouseEvent::Release) {
+            painter->setPen(Qt::NoPen);
+            painter->drawEllipse(sample.pos, 0.5 * width, 0.5 * width);
+            from = sample.pos;
+        }
+    }
+}
+
+void LanePreview::sampleAdded() {
+    // repaint just the newest segment
+    const LaneSample &last = lane.samples.last();
+    QPointF from = (lane.samples.size() > 1) ? lane.samples[lane.samples.size() - 2].pos : last.pos;
+    double margin = lineWidth * qMax(1.0f, last.pressure);
+    update(QRectF(from, last.pos).normalized().adjusted(-margin, -margin, margin, margin));
+}
@@ -0,0 +1,63 @@
+#ifndef CAPTURELANE_H
+#define CAPTURELANE_H
+
+#include <QGraphicsItem>
+#include <QVector>
+
+/* One touch contact or stylus sample, as recorded on the input hot path */
+class LaneSample {
+public:
+    int action;
+    QPointF pos;
+    quint64 time;
+    float distance;
+    float speed;
+    float pressure;
+};
+
+class LanePreview;
+
+/* Capture state for one contact: its own kinematics and a sample buffer of fixed
+ * capacity, reserved when the lane is first pressed, so recording a sample is a plain
+ * copy into memory that already exists. The buffer never grows: once full, presses and
+ * moves are dropped, with one slot always kept for the Release of an active contact.
+ * Lanes are reused slot by slot; endCapture turns each non-empty one into its own tab. */
+class CaptureLane {
+public:
+    static const int capacity = 1 << 14;
+
+    quint64 contactKey;
+    bool active;
+    QPointF lastPoint;
+    quint64 prevTimestamp;
+    QVector<LaneSample> samples;
+    LanePreview *preview;
+
+    CaptureLane();
+
+    void reserve();
+    // false when the buffer is full; the lane then stays inactive
+    bool press(quint64 _contactKey, QPointF p, quint64 time, float pressure);
+    // false when the sample was dropped because the buffer is full
+    bool move(QPointF p, quint64 time, float pressure);
+    void release(QPointF p, quint64 time, float pressure);
+    void clear();
+};
+
+/* Live drawing of a lane straight from its sample buffer. Each new sample only
+ * invalidates the rect of its own segment; nothing is allocated per sample. */
+class LanePreview : public QGraphicsItem {
+    const CaptureLane &lane;
+    QRectF area;
+    double lineWidth;
+
+public:
+    LanePreview(const CaptureLane &_lane, QRectF _area, double _lineWidth);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+    void sampleAdded();
+};
+
+#endif // CAPTURELANE_H
@@ -0,0 +1,213 @@
+#include "capturepublisher.h"
+
+#include <QtEndian>
+
+#include <string.h>
+
+namespace {
+
+// a subscriber with more than this still unsent misses sample frames until it catches up
+const qint64 maxPendingBytes = 256 * 1024;
+
+// batching interval for sample frames
+const int flushIntervalMs = 8;
+
+// how long start() waits to find out whether an existing socket is still served
+const int probeTimeoutMs = 200;
+
+char *putU8(char *out, quint8 value) {
+    *out = (char)value;
+    return out + 1;
+}
+
+char *putU16(char *out, quint16 value) {
+    qToLittleEndian(value, out);
+    return out + 2;
+}
+
+char *putU32(char *out, quint32 value) {
+    qToLittleEndian(value, out);
+    return out + 4;
+}
+
+char *putU64(char *out, quint64 value) {
+    qToLittleEndian(value, out);
+    return out + 8;
+}
+
+char *putFloat(char *out, float value) {
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return putU32(out, bits);
+}
+
+}
+
+CapturePublisher::CapturePublisher(const QString &_serverName, QObject *parent)
+    : QObject(parent), serverName(_serverName), queueHead(0), queueCount(0), dropped(0) {
+
+    frame.reserve(headerSize + 4 + 2 + queueCapacity * sampleSize);
+    flushTimer.setInterval(flushIntervalMs);
+
+    connect(&server, &QLocalServer::newConnection, this, &CapturePublisher::newConnection);
+    connect(&flushTimer, &QTimer::timeout, this, &CapturePublisher::flush);
+}
+
+CapturePublisher::~CapturePublisher() {
+    stop();
+}
+
+bool CapturePublisher::start() {
+    if (server.isListening()) return true;
+
+    if (server.listen(serverName)) return true;
+    if (server.serverError() != QAbstractSocket::AddressInUseError) return false;
+
+    // someone answering means another instance is streaming: leave its socket alone
+    QLocalSocket probe;
+    probe.connectToServer(serverName);
+    if (probe.waitForConnected(probeTimeoutMs)) {
+        probe.abort();
+        return false;
+    }
+
+    // nobody home: a crashed previous run left the socket file behind
+    QLocalServer::removeServer(serverName);
+    return server.listen(serverName);
+}
+
+void CapturePublisher::stop() {
+    flushTimer.stop();
+    server.close();
+    for (const Subscriber &subscriber : subscribers) {
+        subscriber.socket->disconnect(this);
+        subscriber.socket->abort();
+        subscriber.socket->deleteLater();
+    }
+    subscribers.clear();
+    queueHead = 0;
+    queueCount = 0;
+    dropped = 0;
+}
+
+QString CapturePublisher::fullServerName() const {
+    return server.fullServerName();
+}
+
+void CapturePublisher::newConnection() {
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+        subscribers.append(Subscriber{socket, 0});
+
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            for (int i = 0; i < subscribers.length(); ++i) {
+                if (subscribers[i].socket == socket) {
+                    subscribers.removeAt(i);
+                    break;
+                }
+            }
+            socket->deleteLater();
+            if (subscribers.isEmpty()) flushTimer.stop();
+        });
+    }
+    if (!subscribers.isEmpty()) flushTimer.start();
+}
+
+void CapturePublisher::publishEvent(const MouseEvent &event) {
+    enqueue(0, event.action, event.pos, event.time, event.distance, event.speed);
+}
+
+void CapturePublisher::publishLaneSample(int lane, const LaneSample &sample) {
+    enqueue((quint8)(1 + lane), sample.action, sample.pos, sample.time, sample.distance, sample.speed);
+}
+
+/* Hot path, called from Scribbler's mouse handlers and lanes: one copy into the ring, nothing else */
+void CapturePublisher::enqueue(quint8 contact, int action, QPointF pos, quint64 time, float distance, float speed) {
+    if (subscribers.isEmpty()) return;
+
+    if (queueCount == queueCapacity) {
+        ++dropped;
+        return;
+    }
+
+    Sample &sample = queue[(queueHead + queueCount) % queueCapacity];
+    sample.action = (quint8)action;
+    sample.contact = contact;
+    sample.x = (float)pos.x();
+    sample.y = (float)pos.y();
+    sample.time = time;
+    sample.distance = distance;
+    sample.speed = speed;
+    ++queueCount;
+}
+
+void CapturePublisher::publishCommit() {
+    sendMarker(Commit);
+}
+
+void CapturePublisher::publishReset() {
+    sendMarker(Reset);
+}
+
+void CapturePublisher::flush() {
+    // a subscriber that has caught up is owed its drop count even when nothing new is queued
+    bool owed = (queueCount > 0 || dropped > 0);
+    for (const Subscriber &subscriber : subscribers) {
+        if (subscriber.dropped > 0 && subscriber.socket->bytesToWrite() <= maxPendingBytes) owed = true;
+    }
+    if (owed) sendFrame();
+}
+
+void CapturePublisher::sendMarker(FrameType type) {
+    if (subscribers.isEmpty()) return;
+
+    // markers must follow the samples that led up to them
+    flush();
+
+    char header[headerSize];
+    char *out = putU8(header, type);
+    putU32(out, 0);
+
+    // only 5 bytes, and missing one would merge captures or hide a reset, so even a backed-up subscriber gets it
+    for (const Subscriber &subscriber : subscribers) {
+        subscriber.socket->write(header, headerSize);
+    }
+}
+
+void CapturePublisher::sendFrame() {
+    // queueCapacity keeps count within the quint16 field
+    int count = queueCount;
+    int payloadLength = 4 + 2 + count * sampleSize;
+
+    frame.resize(headerSize + payloadLength);
+    char *out = frame.data();
+    out = putU8(out, Samples);
+    out = putU32(out, payloadLength);
+    out = putU32(out, dropped);
+    out = putU16(out, count);
+
+    for (int i = 0; i < count; ++i) {
+        const Sample &sample = queue[(queueHead + i) % queueCapacity];
+        out = putU8(out, sample.action);
+        out = putU8(out, sample.contact);
+        out = putFloat(out, sample.x);
+        out = putFloat(out, sample.y);
+        out = putU64(out, sample.time);
+        out = putFloat(out, sample.distance);
+        out = putFloat(out, sample.speed);
+    }
+    queueHead = (queueHead + count) % queueCapacity;
+    queueCount -= count;
+
+    // a subscriber that isn't reading loses this frame instead of growing its buffer, and is told how much it lost in the next one it gets
+    char *droppedField = frame.data() + headerSize;
+    for (Subscriber &subscriber : subscribers) {
+        if (subscriber.socket->bytesToWrite() > maxPendingBytes) {
+            subscriber.dropped += dropped + count;
+            continue;
+        }
+        putU32(droppedField, dropped + subscriber.dropped);
+        subscriber.socket->write(frame.constData(), frame.size());
+        subscriber.dropped = 0;
+    }
+    dropped = 0;
+}
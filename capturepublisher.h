@@ -0,0 +1,91 @@
+#ifndef CAPTUREPUBLISHER_H
+#define CAPTUREPUBLISHER_H
+
+#include "scribbler.h"
+#include "capturelane.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+
+/* Streams MouseEvents to local subscribers over a QLocalServer (a Unix domain socket on
+ * Unix). Samples are copied into a fixed ring and sent in batches on a timer, so the
+ * mouse handlers never wait on a subscriber: a full ring or a backed-up socket drops.
+ *
+ * Wire format, all little endian. Every frame is
+ *     quint8 type, quint32 payloadLength, payload
+ * Samples payload:  quint32 droppedSinceLastFrame, quint16 count, then count samples of
+ *     quint8 action, quint8 contact, float x, float y, quint64 time, float distance, float speed
+ * where contact 0 is the mouse and 1 + n is touch/tablet lane n, one per simultaneous contact.
+ * Commit and Reset carry no payload and are never dropped. droppedSinceLastFrame counts
+ * samples this subscriber missed, whether the ring was full or its own socket was backed up. */
+class CapturePublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum FrameType : quint8 {
+        Samples = 1,
+        Commit = 2,
+        Reset = 3
+    };
+
+    static const int queueCapacity = 4096;
+    static const int sampleSize = 1 + 1 + 4 + 4 + 8 + 4 + 4;
+    static const int headerSize = 1 + 4;
+
+    CapturePublisher(const QString &_serverName, QObject *parent = nullptr);
+    ~CapturePublisher();
+
+    bool start();
+    void stop();
+    QString fullServerName() const;
+
+public slots:
+    void publishEvent(const MouseEvent &event);
+    void publishLaneSample(int lane, const LaneSample &sample);
+    void publishCommit();
+    void publishReset();
+
+private slots:
+    void newConnection();
+    void flush();
+
+private:
+    struct Sample {
+        quint8 action;
+        quint8 contact;
+        float x;
+        float y;
+        quint64 time;
+        float distance;
+        float speed;
+    };
+
+    struct Subscriber {
+        QLocalSocket *socket;
+        // samples this subscriber missed since the last frame it was sent
+        quint32 dropped;
+    };
+
+    QString serverName;
+    QLocalServer server;
+    QList<Subscriber> subscribers;
+    QTimer flushTimer;
+
+    // bounded ring of pending samples, only touched from the GUI thread
+    Sample queue[queueCapacity];
+    int queueHead;
+    int queueCount;
+    // samples lost to a full ring, owed to every subscriber
+    quint32 dropped;
+
+    // reused for every frame so sending doesn't allocate once it has grown
+    QByteArray frame;
+
+    void enqueue(quint8 contact, int action, QPointF pos, quint64 time, float distance, float speed);
+    void sendMarker(FrameType type);
+    void sendFrame();
+};
+
+#endif // CAPTUREPUBLISHER_H
@@ -0,0 +1,409 @@
+#include "eventio.h"
+#include "overview.h"
+
+#include <QDataStream>
+
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+const char *actionName(int action) {
+    switch (action) {
+        case MouseEvent::Press:
+            return "Press";
+        case MouseEvent::Move:
+            return "Move";
+        case MouseEvent::Release:
+            return "Release";
+    }
+    return "Unknown";
+}
+
+int actionFromName(const char *name, size_t len) {
+    if (len == 5 && !strncmp(name, "Press", len)) return MouseEvent::Press;
+    if (len == 4 && !strncmp(name, "Move", len)) return MouseEvent::Move;
+    if (len == 7 && !strncmp(name, "Release", len)) return MouseEvent::Release;
+    return -1;
+}
+
+/* Rows are formatted straight into a fixed block with std::to_chars and the block is
+ * handed to the device only when full, so no per-row QString or QByteArray is built. */
+class BlockWriter {
+    static const int blockSize = 1 << 16;
+    static const int maxRowSize = 512;
+
+    QIODevice &out;
+    char block[blockSize];
+    int used;
+    bool ok;
+
+public:
+    BlockWriter(QIODevice &_out) : out(_out), used(0), ok(true) {}
+
+    // make sure one full row fits before formatting it
+    void beginRow() {
+        if (blockSize - used < maxRowSize) flush();
+    }
+
+    void put(char c) {
+        block[used++] = c;
+    }
+
+    void put(const char *str) {
+        size_t len = strlen(str);
+        memcpy(block + used, str, len);
+        used += len;
+    }
+
+    template <typename T>
+    void number(T value) {
+        std::to_chars_result res = std::to_chars(block + used, block + blockSize, value);
+        used = res.ptr - block;
+    }
+
+    bool flush() {
+        if (ok && used > 0 && out.write(block, used) != used) ok = false;
+        used = 0;
+        return ok;
+    }
+};
+
+void writeCsvRow(BlockWriter &writer, int brush, const MouseEvent *event) {
+    writer.beginRow();
+    writer.number(brush);
+    writer.put(',');
+    writer.number(event->pos.x());
+    writer.put(',');
+    writer.number(event->pos.y());
+    writer.put(',');
+    writer.put(actionName(event->action));
+    writer.put(',');
+    writer.number(event->time);
+    writer.put(',');
+    writer.number(event->distance);
+    writer.put(',');
+    writer.number(event->speed);
+    writer.put(',');
+    writer.number(event->pressure);
+    writer.put('\n');
+}
+
+void writeJsonRow(BlockWriter &writer, int brush, const MouseEvent *event) {
+    writer.beginRow();
+    writer.put("{\"brush\":");
+    writer.number(brush);
+    writer.put(",\"x\":");
+    writer.number(event->pos.x());
+    writer.put(",\"y\":");
+    writer.number(event->pos.y());
+    writer.put(",\"action\":\"");
+    writer.put(actionName(event->action));
+    writer.put("\",\"time\":");
+    writer.number(event->time);
+    writer.put(",\"distance\":");
+    writer.number(event->distance);
+    writer.put(",\"speed\":");
+    writer.number(event->speed);
+    writer.put(",\"pressure\":");
+    writer.number(event->pressure);
+    writer.put("}\n");
+}
+
+/* One parsed row. Same columns as the event tables, plus the brush (tab) it belongs to */
+struct Row {
+    long brush;
+    double x;
+    double y;
+    int action;
+    quint64 time;
+    float distance;
+    float speed;
+    float pressure;
+};
+
+const char *skipSpace(const char *p) {
+    while (*p == ' ' || *p == '\t') ++p;
+    return p;
+}
+
+// std::from_chars, unlike strtod, ignores the C locale, so it reads back exactly what to_chars wrote
+template <typename T>
+bool readNumber(const char *&p, const char *last, T &value) {
+    p = skipSpace(p);
+    std::from_chars_result res = std::from_chars(p, last, value);
+    if (res.ec != std::errc()) return false;
+    p = res.ptr;
+    return true;
+}
+
+// CSV row: brush,x,y,action,time,distance,speed[,pressure]. last points at the row's terminating NUL
+bool parseCsvRow(const char *p, const char *last, Row &row) {
+    if (!readNumber(p, last, row.brush) || *p++ != ',') return false;
+    if (!readNumber(p, last, row.x) || *p++ != ',') return false;
+    if (!readNumber(p, last, row.y) || *p++ != ',') return false;
+    p = skipSpace(p);
+    const char *comma = strchr(p, ',');
+    if (!comma) return false;
+    row.action = actionFromName(p, comma - p);
+    if (row.action < 0) return false;
+    p = comma + 1;
+    if (!readNumber(p, last, row.time) || *p++ != ',') return false;
+    if (!readNumber(p, last, row.distance) || *p++ != ',') return false;
+    if (!readNumber(p, last, row.speed)) return false;
+
+    // exports from before touch and tablet input have no pressure column
+    row.pressure = 1.0f;
+    if (*p == ',') {
+        ++p;
+        if (!readNumber(p, last, row.pressure)) return false;
+    }
+    return true;
+}
+
+// JSON row: a flat object with the same keys as writeJsonRow, in any order. pressure may be left out
+bool parseJsonRow(const char *p, const char *last, Row &row) {
+    int seen = 0;
+    row.pressure = 1.0f;
+    p = skipSpace(p);
+    if (*p++ != '{') return false;
+
+    while (true) {
+        p = skipSpace(p);
+        if (*p == '}') break;
+        if (*p++ != '"') return false;
+        const char *key = p;
+        const char *keyEnd = strchr(p, '"');
+        if (!keyEnd) return false;
+        size_t keyLen = keyEnd - key;
+        p = skipSpace(keyEnd + 1);
+        if (*p++ != ':') return false;
+        p = skipSpace(p);
+
+        bool ok;
+        if (keyLen == 6 && !strncmp(key, "action", keyLen)) {
+            if (*p++ != '"') return false;
+            const char *valueEnd = strchr(p, '"');
+            if (!valueEnd) return false;
+            row.action = actionFromName(p, valueEnd - p);
+            ok = row.action >= 0;
+            p = valueEnd + 1;
+            seen |= 1 << 3;
+        } else if (keyLen == 5 && !strncmp(key, "brush", keyLen)) {
+            ok = readNumber(p, last, row.brush);
+            seen |= 1 << 0;
+        } else if (keyLen == 1 && *key == 'x') {
+            ok = readNumber(p, last, row.x);
+            seen |= 1 << 1;
+        } else if (keyLen == 1 && *key == 'y') {
+            ok = readNumber(p, last, row.y);
+            seen |= 1 << 2;
+        } else if (keyLen == 4 && !strncmp(key, "time", keyLen)) {
+            ok = readNumber(p, last, row.time);
+            seen |= 1 << 4;
+        } else if (keyLen == 8 && !strncmp(key, "distance", keyLen)) {
+            ok = readNumber(p, last, row.distance);
+            seen |= 1 << 5;
+        } else if (keyLen == 5 && !strncmp(key, "speed", keyLen)) {
+            ok = readNumber(p, last, row.speed);
+            seen |= 1 << 6;
+        } else if (keyLen == 8 && !strncmp(key, "pressure", keyLen)) {
+            ok = readNumber(p, last, row.pressure);
+        } else {
+            return false;
+        }
+        if (!ok) return false;
+
+        p = skipSpace(p);
+        if (*p == ',') ++p;
+    }
+    return seen == 0x7f;
+}
+
+}
+
+bool EventIO::writeScribbleFile(QIODevice &out, const QList<QList<MouseEvent*>*> &storedEvents) {
+    // The overview goes first with its size in front, so a preview reads only that much
+    QByteArray overviewBytes;
+    QDataStream overviewOut(&overviewBytes, QIODevice::WriteOnly);
+    overviewOut << ScribbleOverview::build(storedEvents);
+
+    QDataStream saveOut(&out);
+    saveOut << scribbleMagic << scribbleVersion;
+    saveOut << overviewBytes;
+
+    // Save the number of tabs to file
+    int numTabs = storedEvents.length();
+    saveOut << numTabs;
+
+    // Iterate over all events in the list of copied *events
+    for (const QList<MouseEvent*> *events : storedEvents) {
+        // Save size of events to file
+        int eventsCount = events->length();
+        saveOut << eventsCount;
+
+        // Save individual events to file
+        for (const MouseEvent *event : *events) {
+            saveOut << event->pos;
+            saveOut << event->action;
+            saveOut << event->time;
+            saveOut << event->distance;
+            saveOut << event->speed;
+            saveOut << event->pressure;
+        }
+    }
+    return saveOut.status() == QDataStream::Ok;
+}
+
+bool EventIO::readScribbleOverview(QIODevice &in, ScribbleOverview &overview) {
+    QDataStream openIn(&in);
+    quint32 magic;
+    quint32 version;
+    openIn >> magic >> version;
+
+    // files from before the overview existed have nothing to show without a full load
+    if (openIn.status() != QDataStream::Ok || magic != scribbleMagic || version > scribbleVersion) return false;
+
+    QByteArray overviewBytes;
+    openIn >> overviewBytes;
+    if (openIn.status() != QDataStream::Ok) return false;
+
+    QDataStream overviewIn(overviewBytes);
+    overviewIn >> overview;
+    return overviewIn.status() == QDataStream::Ok;
+}
+
+bool EventIO::readScribbleFile(QIODevice &in, QList<QList<MouseEvent*>*> &storedEvents) {
+    QDataStream openIn(&in);
+    int numTabs;
+    quint32 version = 0;
+
+    // Current files open with the magic number and an overview to skip. Older ones start with the number of tabs
+    quint32 magic;
+    openIn >> magic;
+    if (magic == scribbleMagic) {
+        quint32 overviewSize;
+        openIn >> version >> overviewSize;
+        if (openIn.status() != QDataStream::Ok || version > scribbleVersion || openIn.skipRawData(overviewSize) != (int)overviewSize) return false;
+        openIn >> numTabs;
+    } else {
+        numTabs = (int)magic;
+    }
+    if (openIn.status() != QDataStream::Ok || numTabs < 0) return false;
+
+    // pos, action, time, distance, speed (floats go out as doubles), then pressure from version 2 on
+    bool hasPressure = version >= 2;
+    const qint64 eventSize = 16 + 4 + 8 + 8 + 8 + (hasPressure ? 8 : 0);
+
+    QList<QList<MouseEvent*>*> loaded;
+    bool ok = true;
+
+    for (int tabIdx = 0; ok && tabIdx < numTabs; ++tabIdx) {
+        int eventsCount;
+        openIn >> eventsCount;
+
+        // don't trust a count the rest of the file can't hold
+        if (openIn.status() != QDataStream::Ok || eventsCount < 0 || eventsCount * eventSize > in.bytesAvailable()) {
+            ok = false;
+            break;
+        }
+
+        QList<MouseEvent*> *events = new QList<MouseEvent*>();
+        events->reserve(eventsCount);
+        loaded.append(events);
+
+        for (int i = 0; i < eventsCount; ++i) {
+            QPointF pos;
+            int action;
+            quint64 time;
+            float distance;
+            float speed;
+            float pressure = 1.0f;
+
+            openIn >> pos >> action >> time >> distance >> speed;
+            if (hasPressure) openIn >> pressure;
+            if (openIn.status() != QDataStream::Ok || action < MouseEvent::Press || action > MouseEvent::Release) {
+                ok = false;
+                break;
+            }
+            events->append(new MouseEvent(action, pos, time, distance, speed, QList<QGraphicsItem*>{}, pressure));
+        }
+    }
+
+    if (!ok) {
+        for (QList<MouseEvent*> *events : loaded) {
+            qDeleteAll(*events);
+            delete events;
+        }
+        return false;
+    }
+    storedEvents << loaded;
+    return true;
+}
+
+bool EventIO::exportEvents(QIODevice &out, const QList<QList<MouseEvent*>*> &storedEvents, Format format) {
+    BlockWriter writer(out);
+
+    if (format == Csv) {
+        writer.beginRow();
+        writer.put("brush,x,y,action,time,distance,speed,pressure\n");
+    }
+
+    for (int brush = 0; brush < storedEvents.length(); ++brush) {
+        for (const MouseEvent *event : *storedEvents[brush]) {
+            if (format == Csv) {
+                writeCsvRow(writer, brush, event);
+            } else {
+                writeJsonRow(writer, brush, event);
+            }
+        }
+    }
+    return writer.flush();
+}
+
+bool EventIO::importEvents(QIODevice &in, QList<QList<MouseEvent*>*> &storedEvents, QString *error) {
+    char line[512];
+    qint64 lineNum = 0;
+    bool formatKnown = false;
+    bool isJson = false;
+    long prevBrush = -1;
+    QList<MouseEvent*> *events = nullptr;
+
+    while (true) {
+        qint64 len = in.readLine(line, sizeof(line));
+        if (len <= 0) break;
+        ++lineNum;
+
+        // a row that fills the whole buffer without a newline is not one of ours
+        if (len == (qint64)sizeof(line) - 1 && line[len - 1] != '\n') {
+            if (error) *error = QString("Line %1 is too long").arg(lineNum);
+            return false;
+        }
+
+        const char *p = skipSpace(line);
+        if (*p == '\n' || *p == '\r' || *p == '\0') continue;
+
+        // First non-blank line decides the format. CSV has a header row to skip
+        if (!formatKnown) {
+            formatKnown = true;
+            isJson = (*p == '{');
+            if (!isJson && !strncmp(p, "brush,", 6)) continue;
+        }
+
+        Row row;
+        bool parsed = isJson ? parseJsonRow(p, line + len, row) : parseCsvRow(p, line + len, row);
+        if (!parsed) {
+            if (error) *error = QString("Malformed row on line %1").arg(lineNum);
+            return false;
+        }
+
+        // a change of brush column starts a new capture
+        if (!events || row.brush != prevBrush) {
+            events = new QList<MouseEvent*>();
+            storedEvents.append(events);
+            prevBrush = row.brush;
+        }
+        events->append(new MouseEvent(row.action, QPointF(row.x, row.y), row.time, row.distance, row.speed, QList<QGraphicsItem*>{}, row.pressure));
+    }
+    return true;
+}
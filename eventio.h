@@ -0,0 +1,39 @@
+#ifndef EVENTIO_H
+#define EVENTIO_H
+
+#include "scribbler.h"
+#include "overview.h"
+
+#include <QIODevice>
+
+/* Reading and writing of saved scribble files, and streaming export/import of captures as CSV or
+ * newline-delimited JSON. Rows are formatted into a fixed buffer and flushed to the
+ * device in blocks, so memory stays constant no matter how large the session is. */
+namespace EventIO {
+
+// Saved files start with these, followed by the size-prefixed ScribbleOverview
+const quint32 scribbleMagic = 0x53435242; // "SCRB"
+// Version 2 added per event pressure
+const quint32 scribbleVersion = 2;
+
+enum Format {
+    Csv,
+    Json
+};
+
+bool writeScribbleFile(QIODevice &out, const QList<QList<MouseEvent*>*> &storedEvents);
+
+// Reads just the header of a saved file. False for files saved before overviews existed
+bool readScribbleOverview(QIODevice &in, ScribbleOverview &overview);
+
+// Appends one QList<MouseEvent*> per tab saved by writeScribbleFile, old files without an overview included. Returns false on a truncated or foreign file.
+bool readScribbleFile(QIODevice &in, QList<QList<MouseEvent*>*> &storedEvents);
+
+bool exportEvents(QIODevice &out, const QList<QList<MouseEvent*>*> &storedEvents, Format format);
+
+// Appends one QList<MouseEvent*> per brush found in the stream to storedEvents. Format is detected from the first non-blank line.
+bool importEvents(QIODevice &in, QList<QList<MouseEvent*>*> &storedEvents, QString *error = nullptr);
+
+}
+
+#endif // EVENTIO_H
@@ -0,0 +1,177 @@
+#include "heatmap.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <math.h>
+
+namespace {
+
+// gaps longer than this are the pen resting or lifted, not dwelling
+const quint64 maxDwellMs = 100;
+
+// below this many events in total, binning stays on the calling thread
+const int parallelThreshold = 1 << 14;
+
+/* 256 entry ramp: transparent blue for cold cells through cyan and yellow to opaque red */
+const QVector<QRgb> &colorTable() {
+    static QVector<QRgb> table = []() {
+        QVector<QRgb> colors(256);
+        for (int i = 0; i < 256; ++i) {
+            float t = i / 255.0f;
+            QColor color;
+            color.setHsvF((1.0f - t) * 0.66f, 1.0f, 1.0f, 0.35f + 0.65f * t);
+            colors[i] = color.rgba();
+        }
+        return colors;
+    }();
+    return table;
+}
+
+void addGrid(Heatmap::Grid &result, const Heatmap::Grid &partial) {
+    if (result.count.isEmpty()) {
+        result = partial;
+        return;
+    }
+    for (int i = 0; i < result.count.size(); ++i) {
+        result.count[i] += partial.count[i];
+        result.dwell[i] += partial.dwell[i];
+        result.speed[i] += partial.speed[i];
+    }
+}
+
+}
+
+Heatmap::Heatmap(QRectF _area, int _cellSize)
+    : area(_area), cellPixels(_cellSize), samples(0) {
+    columns = (int)ceil(area.width() / cellPixels);
+    rows = (int)ceil(area.height() / cellPixels);
+    clear();
+}
+
+void Heatmap::clear() {
+    grid.count.fill(0.0f, columns * rows);
+    grid.dwell.fill(0.0f, columns * rows);
+    grid.speed.fill(0.0f, columns * rows);
+    samples = 0;
+}
+
+bool Heatmap::isEmpty() const {
+    return samples == 0;
+}
+
+int Heatmap::cellSize() const {
+    return cellPixels;
+}
+
+QPointF Heatmap::origin() const {
+    return area.topLeft();
+}
+
+/* Bins events [first, last) of one capture into partial. Dwell of an event is the time until the next one of the same stroke */
+void Heatmap::binEvents(Grid &partial, const QList<MouseEvent*> &events, int first, int last) const {
+    for (int i = first; i < last; ++i) {
+        const MouseEvent *event = events[i];
+        // floor, not a cast: a cast rounds (-cellSize, 0) up into cell 0
+        int col = (int)floor((event->pos.x() - area.left()) / cellPixels);
+        int row = (int)floor((event->pos.y() - area.top()) / cellPixels);
+        if (col < 0 || col >= columns || row < 0 || row >= rows) continue;
+
+        float dwell = 0.0f;
+        if (event->action != MouseEvent::Release && i + 1 < events.length()) {
+            quint64 nextTime = events[i + 1]->time;
+            if (nextTime > event->time) dwell = (float)qMin(nextTime - event->time, maxDwellMs);
+        }
+
+        int cell = row * columns + col;
+        partial.count[cell] += 1.0f;
+        partial.dwell[cell] += dwell;
+        partial.speed[cell] += event->speed;
+    }
+}
+
+/* Bins events [begin, end) of the captures laid end to end, offsets[c] being where capture c starts */
+Heatmap::Grid Heatmap::binRange(const QVector<const QList<MouseEvent*>*> &captures, const QVector<qint64> &offsets, qint64 begin, qint64 end) const {
+    Grid partial;
+    partial.count.fill(0.0f, columns * rows);
+    partial.dwell.fill(0.0f, columns * rows);
+    partial.speed.fill(0.0f, columns * rows);
+
+    int c = (int)(std::upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin()) - 1;
+    for (; c < captures.size() && offsets[c] < end; ++c) {
+        int first = (int)(qMax(begin, offsets[c]) - offsets[c]);
+        int last = (int)(qMin(end, offsets[c + 1]) - offsets[c]);
+        binEvents(partial, *captures[c], first, last);
+    }
+    return partial;
+}
+
+void Heatmap::accumulate(const QList<MouseEvent*> &events) {
+    reduce(QVector<const QList<MouseEvent*>*>{&events});
+}
+
+void Heatmap::accumulateAll(const QList<QList<MouseEvent*>*> &storedEvents) {
+    QVector<const QList<MouseEvent*>*> captures;
+    captures.reserve(storedEvents.length());
+    for (const QList<MouseEvent*> *events : storedEvents) {
+        captures.append(events);
+    }
+    reduce(captures);
+}
+
+/* Chunks span capture boundaries, so many small captures are split across workers just like one big one */
+void Heatmap::reduce(const QVector<const QList<MouseEvent*>*> &captures) {
+    QVector<qint64> offsets(captures.size() + 1);
+    offsets[0] = 0;
+    for (int c = 0; c < captures.size(); ++c) {
+        offsets[c + 1] = offsets[c] + captures[c]->length();
+    }
+    qint64 n = offsets.last();
+    if (n == 0) return;
+
+    if (n < parallelThreshold) {
+        addGrid(grid, binRange(captures, offsets, 0, n));
+    } else {
+        // a few chunks per worker: each produces its own partial grid, then they are summed
+        qint64 chunkCount = qMin(n / parallelThreshold, (qint64)QThreadPool::globalInstance()->maxThreadCount() * 4);
+        QList<QPair<qint64, qint64>> chunks;
+        for (qint64 k = 0; k < chunkCount; ++k) {
+            chunks.append(QPair<qint64, qint64>(n * k / chunkCount, n * (k + 1) / chunkCount));
+        }
+
+        Grid sum = QtConcurrent::blockingMappedReduced<Grid>(chunks,
+            [this, &captures, &offsets](const QPair<qint64, qint64> &chunk) {
+                return binRange(captures, offsets, chunk.first, chunk.second);
+            },
+            addGrid);
+        addGrid(grid, sum);
+    }
+    samples += n;
+}
+
+QImage Heatmap::toImage(Weight weight) const {
+    // dwell is shown on a log scale so a few long pauses don't wash out everything else
+    QVector<float> value(columns * rows, 0.0f);
+    float maxValue = 0.0f;
+    for (int i = 0; i < value.size(); ++i) {
+        if (grid.count[i] == 0.0f) continue;
+        value[i] = (weight == Dwell) ? log1pf(grid.dwell[i]) : grid.speed[i] / grid.count[i];
+        maxValue = qMax(maxValue, value[i]);
+    }
+    float scale = (maxValue > 0.0f) ? 254.0f / maxValue : 0.0f;
+
+    // index 0 is kept for cells with no samples and made fully transparent
+    QImage image(columns, rows, QImage::Format_Indexed8);
+    QVector<QRgb> table = colorTable();
+    table[0] = qRgba(0, 0, 0, 0);
+    image.setColorTable(table);
+
+    for (int row = 0; row < rows; ++row) {
+        uchar *line = image.scanLine(row);
+        for (int col = 0; col < columns; ++col) {
+            int cell = row * columns + col;
+            line[col] = (grid.count[cell] == 0.0f) ? 0 : (uchar)(1 + value[cell] * scale);
+        }
+    }
+    return image;
+}
@@ -0,0 +1,54 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include "scribbler.h"
+
+#include <QImage>
+#include <QVector>
+
+/* Grid of dwell time and speed binned from MouseEvent positions. A loaded file is binned
+ * in one parallel reduction on QThreadPool over all its captures; after that the grid only
+ * ever grows by the newest committed capture. */
+class Heatmap
+{
+public:
+    enum Weight {
+        Dwell,
+        Speed
+    };
+
+    struct Grid {
+        QVector<float> count;
+        QVector<float> dwell;
+        QVector<float> speed;
+    };
+
+    Heatmap(QRectF _area, int _cellSize);
+
+    void clear();
+    // One capture, e.g. the one just committed
+    void accumulate(const QList<MouseEvent*> &events);
+    // Every capture of a loaded file, in a single reduction
+    void accumulateAll(const QList<QList<MouseEvent*>*> &storedEvents);
+    bool isEmpty() const;
+
+    int cellSize() const;
+    QPointF origin() const;
+
+    // One pixel per cell, colour mapped, transparent where the pen never went
+    QImage toImage(Weight weight) const;
+
+private:
+    QRectF area;
+    int cellPixels;
+    int columns;
+    int rows;
+    Grid grid;
+    qint64 samples;
+
+    void binEvents(Grid &partial, const QList<MouseEvent*> &events, int first, int last) const;
+    Grid binRange(const QVector<const QList<MouseEvent*>*> &captures, const QVector<qint64> &offsets, qint64 begin, qint64 end) const;
+    void reduce(const QVector<const QList<MouseEvent*>*> &captures);
+};
+
+#endif // HEATMAP_H
@@ -1,9 +1,20 @@
 #include "mainwindow.h"
 #include "scribbler.h"
+#include "eventio.h"
+#include "similarity.h"
 
 #include <QtWidgets>
+#include <QtConcurrent>
 #include <QTableWidgetItem>
 
+namespace {
+
+// thumbnails in the open dialog and the recent files menu
+const QSize previewSize(160, 120);
+const int maxRecentFiles = 8;
+
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), tabCount(0) {
 
@@ -12,14 +23,26 @@ MainWindow::MainWindow(QWidget *parent)
     QAction *openFileAct = new QAction("Open image file");
     QAction *saveFileAct = new QAction("Save image file");
     QAction *resetFileAct = new QAction("Reset file");
+    QAction *exportCsvAct = new QAction("Export events as CSV");
+    QAction *exportJsonAct = new QAction("Export events as JSON lines");
+    QAction *importAct = new QAction("Import events");
 
     // Our capture actions
     QAction *resetCapture = new QAction("Reset capture");
     QAction *endCapture = new QAction("End capture");
+    QAction *findSimilarAct = new QAction("Find similar captures");
+    QAction *findSimilarFolderAct = new QAction("Find similar captures in folder...");
+    QAction *streamAct = new QAction("Stream events to local socket");
+    streamAct->setCheckable(true);
 
     // Our view mode actions
     QAction *lineViewAct = new QAction("Line view");
     QAction *dotsViewAct = new QAction("Dots only view");
+    QAction *heatmapViewAct = new QAction("Heatmap view");
+    QAction *heatmapSpeedAct = new QAction("Heatmap weighted by speed");
+    heatmapSpeedAct->setCheckable(true);
+    QAction *heatmapSelectedAct = new QAction("Heatmap of selected brush only");
+    heatmapSelectedAct->setCheckable(true);
 
     // The menus for these actions
     QMenu *fileBar = new QMenu("&File");
@@ -44,23 +67,48 @@ MainWindow::MainWindow(QWidget *parent)
     mainLayout->setStretchFactor(scribbler, 1);
     mainLayout->setStretchFactor(tabWidget, 1);
 
+    // Ranked results of "find similar captures" live in a dock (hidden until the first search)
+    similarList = new QListWidget();
+    similarDock = new QDockWidget("Similar captures");
+    similarDock->setWidget(similarList);
+    similarDock->setHidden(true);
+    addDockWidget(Qt::RightDockWidgetArea, similarDock);
+
     // Add our actions to menubar
     fileBar->addAction(openFileAct);
     openFileAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_O));
+    recentMenu = fileBar->addMenu("Recent files");
     fileBar->addAction(saveFileAct);
     saveFileAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_S));
     fileBar->addAction(resetFileAct);
     resetFileAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_R));
+    fileBar->addSeparator();
+    fileBar->addAction(exportCsvAct);
+    fileBar->addAction(exportJsonAct);
+    fileBar->addAction(importAct);
+    importAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_I));
 
     captureBar->addAction(resetCapture);
     resetCapture->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_B));
     captureBar->addAction(endCapture);
     endCapture->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_E));
+    captureBar->addSeparator();
+    captureBar->addAction(findSimilarAct);
+    findSimilarAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_F));
+    captureBar->addAction(findSimilarFolderAct);
+    findSimilarFolderAct->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_F));
+    captureBar->addSeparator();
+    captureBar->addAction(streamAct);
 
     viewBar->addAction(lineViewAct);
     lineViewAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_L));
     viewBar->addAction(dotsViewAct);
     dotsViewAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_D));
+    viewBar->addAction(heatmapViewAct);
+    heatmapViewAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_H));
+    viewBar->addSeparator();
+    viewBar->addAction(heatmapSpeedAct);
+    viewBar->addAction(heatmapSelectedAct);
 
     menuBar()->addMenu(fileBar);
     menuBar()->addMenu(captureBar);
@@ -74,6 +122,11 @@ MainWindow::MainWindow(QWidget *parent)
     connect(resetFileAct, &QAction::triggered, scribbler, &Scribbler::resetScribbler);
     connect(scribbler, &Scribbler::resetFile, this, &MainWindow::resetFile);
 
+    // streaming CSV / JSON lines export and import of the event tables
+    connect(exportCsvAct, &QAction::triggered, this, &MainWindow::exportCsv);
+    connect(exportJsonAct, &QAction::triggered, this, &MainWindow::exportJson);
+    connect(importAct, &QAction::triggered, this, &MainWindow::importFile);
+
     // deal with start/end captures and redrawing upon openFile
     connect(resetCapture, &QAction::triggered, scribbler, &Scribbler::resetCapture);
     connect(endCapture, &QAction::triggered, scribbler, &Scribbler::endCapture);
@@ -91,12 +144,32 @@ MainWindow::MainWindow(QWidget *parent)
     connect(lineViewAct, &QAction::triggered, scribbler, &Scribbler::showLines);
     connect(dotsViewAct, &QAction::triggered, scribbler, &Scribbler::showDots);
 
+    // heatmap view: dwell (default) or speed weighted, over all captures or the selected tab
+    connect(heatmapViewAct, &QAction::triggered, scribbler, &Scribbler::showHeatmap);
+    connect(heatmapSpeedAct, &QAction::toggled, scribbler, &Scribbler::setHeatmapBySpeed);
+    connect(heatmapSelectedAct, &QAction::toggled, scribbler, &Scribbler::setHeatmapSelectedOnly);
+    connect(this, &MainWindow::selectHeatmapCapture, scribbler, &Scribbler::selectHeatmapCapture);
+
+    // similarity search over stored captures and saved files
+    connect(findSimilarAct, &QAction::triggered, this, &MainWindow::findSimilar);
+    connect(findSimilarFolderAct, &QAction::triggered, this, &MainWindow::findSimilarInFolder);
+    connect(similarList, &QListWidget::itemActivated, this, &MainWindow::similarActivated);
+
+    // live streaming of captured events to local subscribers (off until enabled from the menu)
+    publisher = new CapturePublisher("scribbler-events", this);
+    connect(scribbler, &Scribbler::eventCaptured, publisher, &CapturePublisher::publishEvent);
+    connect(scribbler, &Scribbler::laneSampleCaptured, publisher, &CapturePublisher::publishLaneSample);
+    connect(scribbler, &Scribbler::captureCommitted, publisher, &CapturePublisher::publishCommit);
+    connect(scribbler, &Scribbler::captureReset, publisher, &CapturePublisher::publishReset);
+    connect(streamAct, &QAction::toggled, this, &MainWindow::streamEvents);
+
     // remove highlight after tab change
     connect(this, &MainWindow::restoreColor, scribbler, &Scribbler::restoreColor);
 
     // directory persistence
     QSettings settings("JKW Systems", "Graphics1");
     dir = settings.value("dir", "").toString();
+    updateRecentFiles();
 }
 
 MainWindow::~MainWindow() {
@@ -108,6 +181,7 @@ void MainWindow::changeTab() {
     int tabIdx = tabWidget->currentIndex();
     emit restoreColor();
     emit adjustOpacity(tabIdx);
+    emit selectHeatmapCapture((tabIdx >= 0 && tabIdx < storedEvents.length()) ? storedEvents[tabIdx] : nullptr);
 }
 
 void MainWindow::itemSelectionChanged() {
@@ -123,18 +197,12 @@ void MainWindow::itemSelectionChanged() {
     }
 }
 
-void MainWindow::addTab(QList<MouseEvent*> &events) {
-    // NO drawings means NO table!
-    if (events.isEmpty()) return;
-
-    // events may be cleared by scribbler. Keep a copy of it to refer to in storedEvents. storedEvents to refer to events of other tabs later.
-    QList<MouseEvent*> *eventsCopy = new QList<MouseEvent*>(events);
-    storedEvents.append(eventsCopy);
-
+/* Builds the read-only table shown in a Brush tab: one row per MouseEvent */
+QTableWidget *MainWindow::createEventsTable(QList<MouseEvent*> &events) {
     // Our table has as many rows as there are MouseEvents. There are 3 things: pos, action, time in MouseEvents to display
     QTableWidget *eventsTable = new QTableWidget();
 
-    connect(eventsTable, &QTableWidget::itemSelectionChanged, this, &MainWindow::itemSelectionChanged); //TEST
+    connect(eventsTable, &QTableWidget::itemSelectionChanged, this, &MainWindow::itemSelectionChanged);
 
     // Stretching automatically
     eventsTable->setSelectionMode(QAbstractItemView::ExtendedSelection);
@@ -142,7 +210,7 @@ void MainWindow::addTab(QList<MouseEvent*> &events) {
     eventsTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
 
     // Sizeof table
-    int colNum = 5;
+    int colNum = 6;
     eventsTable->setRowCount(events.length());
     eventsTable->setColumnCount(colNum);
 
@@ -154,6 +222,7 @@ void MainWindow::addTab(QList<MouseEvent*> &events) {
         QTableWidgetItem *timeItem = new QTableWidgetItem();
         QTableWidgetItem *distItem = new QTableWidgetItem();
         QTableWidgetItem *speedItem = new QTableWidgetItem();
+        QTableWidgetItem *pressureItem = new QTableWidgetItem();
 
         // Table entry formatting of strings from raw events
         QString posText = QString("(%1, %2)").arg(events[i]->pos.x()).arg(events[i]->pos.y());
@@ -162,6 +231,7 @@ void MainWindow::addTab(QList<MouseEvent*> &events) {
         QString timeText = dateTime.toString("s.zzz"); //FROM: https://forum.qt.io/topic/77685/qtime-formatting-hh-mm-ss-s
         QString distText = QString("%1").arg(events[i]->distance);
         QString speedText = QString::number(events[i]->speed, 'f', 2);
+        QString pressureText = QString::number(events[i]->pressure, 'f', 2);
 
         // int to string mapping for actions
         switch (events[i]->action) {
@@ -181,17 +251,31 @@ void MainWindow::addTab(QList<MouseEvent*> &events) {
         timeItem->setData(Qt::DisplayRole, timeText);
         distItem->setData(Qt::DisplayRole, distText);
         speedItem->setData(Qt::DisplayRole, speedText);
+        pressureItem->setData(Qt::DisplayRole, pressureText);
 
         eventsTable->setItem(i, 0, posItem);
         eventsTable->setItem(i, 1, actItem);
         eventsTable->setItem(i, 2, timeItem);
         eventsTable->setItem(i, 3, distItem);
         eventsTable->setItem(i, 4, speedItem);
+        eventsTable->setItem(i, 5, pressureItem);
     }
     // Table headers
-    QList<QString> tableLabels = {"Position", "Action", "Time(s)", "Distance(pix)", "Speed(pix/ms)"};
+    QList<QString> tableLabels = {"Position", "Action", "Time(s)", "Distance(pix)", "Speed(pix/ms)", "Pressure"};
     eventsTable->setHorizontalHeaderLabels(tableLabels);
     eventsTable->setMinimumSize(400, 600);
+    return eventsTable;
+}
+
+void MainWindow::addTab(QList<MouseEvent*> &events) {
+    // NO drawings means NO table!
+    if (events.isEmpty()) return;
+
+    // events may be cleared by scribbler. Keep a copy of it to refer to in storedEvents. storedEvents to refer to events of other tabs later.
+    QList<MouseEvent*> *eventsCopy = new QList<MouseEvent*>(events);
+    storedEvents.append(eventsCopy);
+
+    QTableWidget *eventsTable = createEventsTable(events);
 
     // updating adding label, etc... TabWidget is newly generated -> make visible.
     QString tabName = "Brush " + QString::number(tabCount);
@@ -205,6 +289,8 @@ void MainWindow::addTab(QList<MouseEvent*> &events) {
 void MainWindow::resetFile() {
     tabCount = 0;
     storedEvents.clear();
+    similarList->clear();
+    similarDock->setHidden(true);
     tabWidget->clear();
     tabWidget->setHidden(true);
 }
@@ -221,38 +307,113 @@ void MainWindow::saveFile() {
         return;
     }
 
-    // Save the number of tabs to file
-    QDataStream saveOut(&outFile);
-    int numTabs = tabWidget->count();
-    saveOut << numTabs;
-
-    // Iterate over all events in the list of copied *events
-    for (QList<QList<MouseEvent*>*>::Iterator eventsIt = storedEvents.begin(); eventsIt != storedEvents.end(); ++eventsIt) {
-        QList<MouseEvent*> *events = *eventsIt;
-
-        // Save size of events to file
-        int eventsCount = events->length();
-        saveOut << eventsCount;
-
-        // Save individual events to file
-        for (MouseEvent *event : *events) {
-            saveOut << event->pos;
-            saveOut << event->action;
-            saveOut << event->time;
-            saveOut << event->distance;
-            saveOut << event->speed;
-        }
+    // events plus the overview header that previews read
+    if (!EventIO::writeScribbleFile(outFile, storedEvents)) {
+        QMessageBox::information(this, "Error", QString("Failed while writing \"%1\"").arg(outFName));
+        return;
     }
     outFile.close();
+
+    dir = QFileInfo(outFName).absolutePath();
+    addRecentFile(outFName);
+}
+
+/* Takes ownership of captures read from disk and gives each its own Brush tab */
+void MainWindow::loadTabs(QList<QList<MouseEvent*>*> &loaded) {
+    for (int tabIdx = 0; tabIdx < loaded.length(); ++tabIdx) {
+        QList<MouseEvent*> *events = loaded[tabIdx];
+        QTableWidget *eventsTable = createEventsTable(*events);
+
+        // updating storedEvents to reflect most recent loaded events tab + adding label, etc...
+        storedEvents.append(events);
+        QString tabName = "Brush " + QString::number(tabCount);
+        tabWidget->addTab(eventsTable, tabName);
+        tabWidget->setHidden(false);
+        tabWidget->show();
+        ++tabCount;
+    }
+}
+
+bool MainWindow::readOverview(const QString &fileName, ScribbleOverview &overview) {
+    QFile inFile(fileName);
+    if (!inFile.open(QIODevice::ReadOnly)) return false;
+    return EventIO::readScribbleOverview(inFile, overview);
+}
+
+void MainWindow::addRecentFile(const QString &fileName) {
+    QSettings settings("JKW Systems", "Graphics1");
+    QStringList recentFiles = settings.value("recentFiles").toStringList();
+    recentFiles.removeAll(fileName);
+    recentFiles.prepend(fileName);
+    while (recentFiles.length() > maxRecentFiles) recentFiles.removeLast();
+    settings.setValue("recentFiles", recentFiles);
+    updateRecentFiles();
+}
+
+/* Rebuilds File > Recent files, with a thumbnail and stats from each file's overview */
+void MainWindow::updateRecentFiles() {
+    recentMenu->clear();
+
+    QSettings settings("JKW Systems", "Graphics1");
+    QStringList recentFiles = settings.value("recentFiles").toStringList();
+    for (const QString &fileName : recentFiles) {
+        QAction *recentAct = recentMenu->addAction(QFileInfo(fileName).fileName());
+
+        ScribbleOverview overview;
+        if (readOverview(fileName, overview)) {
+            recentAct->setIcon(QIcon(overview.thumbnail(previewSize)));
+            recentAct->setToolTip(overview.summary());
+            recentAct->setStatusTip(overview.summary().replace('\n', ", "));
+        }
+        connect(recentAct, &QAction::triggered, this, [this, fileName]() {
+            loadFile(fileName);
+        });
+    }
+    recentMenu->setToolTipsVisible(true);
+    recentMenu->setEnabled(!recentFiles.isEmpty());
 }
 
 void MainWindow::openFile() {
-    // inFile stuff
-    QString inFName = QFileDialog::getOpenFileName(this, "Load scribble file", dir);
-    if (inFName.isEmpty()) {
+    // inFile stuff. Qt's own dialog so there is room for the overview preview next to the file list
+    QFileDialog dialog(this, "Load scribble file", dir);
+    dialog.setFileMode(QFileDialog::ExistingFile);
+    dialog.setOption(QFileDialog::DontUseNativeDialog, true);
+
+    QLabel *previewImage = new QLabel();
+    QLabel *previewText = new QLabel();
+    previewImage->setFixedSize(previewSize);
+    previewText->setWordWrap(true);
+
+    QWidget *preview = new QWidget();
+    QVBoxLayout *previewLayout = new QVBoxLayout(preview);
+    previewLayout->addWidget(previewImage);
+    previewLayout->addWidget(previewText);
+    previewLayout->addStretch();
+
+    QGridLayout *dialogLayout = qobject_cast<QGridLayout*>(dialog.layout());
+    if (dialogLayout) {
+        dialogLayout->addWidget(preview, 0, dialogLayout->columnCount(), dialogLayout->rowCount(), 1);
+    }
+
+    // only the overview header of the highlighted file is read
+    connect(&dialog, &QFileDialog::currentChanged, preview, [previewImage, previewText](const QString &path) {
+        ScribbleOverview overview;
+        if (readOverview(path, overview)) {
+            previewImage->setPixmap(overview.thumbnail(previewSize));
+            previewText->setText(overview.summary());
+        } else {
+            previewImage->clear();
+            previewText->setText(QFileInfo(path).isFile() ? "No preview" : "");
+        }
+    });
+
+    if (dialog.exec() != QDialog::Accepted || dialog.selectedFiles().isEmpty()) {
         return;
     }
+    loadFile(dialog.selectedFiles().first());
+}
 
+void MainWindow::loadFile(const QString &inFName) {
     // persistent dir stuff
     dir = QFileInfo(inFName).absolutePath();
 
@@ -263,109 +424,170 @@ void MainWindow::openFile() {
         return;
     }
 
+    QList<QList<MouseEvent*>*> loaded;
+    if (!EventIO::readScribbleFile(inFile, loaded)) {
+        QMessageBox::information(this, "Failed to load file", inFName);
+        return;
+    }
+    inFile.close();
+
     // Reset the file and window before opening the new file
     resetFile();
+    loadTabs(loaded);
+    addRecentFile(inFName);
 
-    QDataStream openIn(&inFile);
+    // send signal to scribbler so that it canr redraw with tabs info from file and also adjust opacity with tabs on start
+    emit drawFromEvents(storedEvents);
+    emit adjustOpacity(tabWidget->currentIndex());
+}
 
-    int numTabs;
-    int eventsCount;
+void MainWindow::exportFile(EventIO::Format format) {
+    QString filter = (format == EventIO::Csv) ? "CSV files (*.csv)" : "JSON lines files (*.jsonl *.ndjson)";
+    QString outFName = QFileDialog::getSaveFileName(this, "Export events", dir, filter);
+    if (outFName.isEmpty()) return;
 
-    // set numTabs from file
-    openIn >> numTabs;
+    QFile outFile(outFName);
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::information(this, "Error", QString("Can't write to file \"%1\"").arg(outFName));
+        return;
+    }
 
-    for (int tabIdx = 0; tabIdx < numTabs; ++tabIdx) {
+    // rows are streamed straight to the file, nothing is held as strings
+    if (!EventIO::exportEvents(outFile, storedEvents, format)) {
+        QMessageBox::information(this, "Error", QString("Failed while writing \"%1\"").arg(outFName));
+    }
+    outFile.close();
+}
 
-        // set number of events in events list
-        openIn >> eventsCount;
+void MainWindow::exportCsv() {
+    exportFile(EventIO::Csv);
+}
 
-        QTableWidget *eventsTable = new QTableWidget();
+void MainWindow::exportJson() {
+    exportFile(EventIO::Json);
+}
 
-        connect(eventsTable, &QTableWidget::itemSelectionChanged, this, &MainWindow::itemSelectionChanged);
+void MainWindow::importFile() {
+    QString inFName = QFileDialog::getOpenFileName(this, "Import events", dir, "Event files (*.csv *.jsonl *.ndjson);;All files (*)");
+    if (inFName.isEmpty()) return;
 
-        // Stretching automatically
-        eventsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
-        eventsTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    dir = QFileInfo(inFName).absolutePath();
 
-        // Set size of table
-        int colCount = 5;
-        eventsTable->setColumnCount(colCount);
-        eventsTable->setRowCount(eventsCount);
+    QFile inFile(inFName);
+    if (!inFile.open(QIODevice::ReadOnly)) {
+        QMessageBox::information(this, "Failed to load file", inFName);
+        return;
+    }
 
-        QList<MouseEvent*> *events = new QList<MouseEvent*>();
-        for (int i = 0; i < eventsCount; ++i) {
-            QPointF pos;
-            int action;
-            quint64 time;
-            float distance;
-            float speed;
+    // Parse into a separate list first so a bad file leaves the current session alone
+    QList<QList<MouseEvent*>*> imported;
+    QString error;
+    if (!EventIO::importEvents(inFile, imported, &error)) {
+        QMessageBox::information(this, "Failed to import file", QString("%1: %2").arg(inFName, error));
+        for (QList<MouseEvent*> *events : imported) {
+            qDeleteAll(*events);
+            delete events;
+        }
+        return;
+    }
+    inFile.close();
 
-            // extract from stream data on event
-            openIn >> pos;
-            openIn >> action;
-            openIn >> time;
-            openIn >> distance;
-            openIn >> speed;
+    resetFile();
+    loadTabs(imported);
 
-            // create new event corresponding in saved events
-            events->append(new MouseEvent(action, pos, time, distance, speed, QList<QGraphicsItem*>{}));
+    // same as openFile: redraw from the imported events
+    emit drawFromEvents(storedEvents);
+    emit adjustOpacity(tabWidget->currentIndex());
+}
 
-            // tableWidget entry stuff
-            QTableWidgetItem *posItem = new QTableWidgetItem();
-            QTableWidgetItem *actItem = new QTableWidgetItem();
-            QTableWidgetItem *timeItem = new QTableWidgetItem();
-            QTableWidgetItem *distItem = new QTableWidgetItem();
-            QTableWidgetItem *speedItem = new QTableWidgetItem();
+void MainWindow::findSimilar() {
+    findSimilarIn(QString());
+}
 
-            // Formatting to QString for text in table entry
-            QString posText = QString("(%1, %2)").arg(events->at(i)->pos.x()).arg(events->at(i)->pos.y());
-            QString actionText;
-            QDateTime dateTime = QDateTime::fromMSecsSinceEpoch(events->at(i)->time); //FROM: https://forum.qt.io/topic/77685/qtime-formatting-hh-mm-ss-s
-            QString timeText = dateTime.toString("s.zzz"); //FROM: https://forum.qt.io/topic/77685/qtime-formatting-hh-mm-ss-s
-            QString distText = QString("%1").arg(distance);
-            QString speedText = QString::number(speed, 'f', 2);
+void MainWindow::findSimilarInFolder() {
+    QString folder = QFileDialog::getExistingDirectory(this, "Search folder for similar captures", dir);
+    if (folder.isEmpty()) return;
+    findSimilarIn(folder);
+}
 
-            // int to string mapping for actions
-            switch (events->at(i)->action) {
-            case MouseEvent::Press:
-                actionText = "Press";
-                break;
-            case MouseEvent::Move:
-                actionText = "Move";
-                break;
-            case MouseEvent::Release:
-                actionText = "Release";
-                break;
-            }
-
-            posItem->setData(Qt::DisplayRole, posText);
-            actItem->setData(Qt::DisplayRole, actionText);
-            timeItem->setData(Qt::DisplayRole, timeText);
-            distItem->setData(Qt::DisplayRole, distText);
-            speedItem->setData(Qt::DisplayRole, speedText);
-
-            eventsTable->setItem(i, 0, posItem);
-            eventsTable->setItem(i, 1, actItem);
-            eventsTable->setItem(i, 2, timeItem);
-            eventsTable->setItem(i, 3, distItem);
-            eventsTable->setItem(i, 4, speedItem);
+/* Ranks every other stored capture (and every capture saved in folder, if given) by DTW distance to the selected tab */
+void MainWindow::findSimilarIn(const QString &folder) {
+    int queryIdx = tabWidget->currentIndex();
+    if (queryIdx < 0 || queryIdx >= storedEvents.length()) {
+        QMessageBox::information(this, "Find similar captures", "End a capture or open a file, then select the brush to search with.");
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Similarity::Signature query = Similarity::signature(*storedEvents[queryIdx]);
+
+    // signatures of session captures and of saved files are both built on the thread pool
+    QList<Similarity::Candidate> candidates;
+    for (int i = 0; i < storedEvents.length(); ++i) {
+        if (i != queryIdx) candidates.append({QString(), i, Similarity::Signature(), 0.0f});
+    }
+    QtConcurrent::blockingMap(candidates, [this](Similarity::Candidate &candidate) {
+        candidate.signature = Similarity::signature(*storedEvents[candidate.brush]);
+    });
+
+    if (!folder.isEmpty()) {
+        QStringList fileNames;
+        QDir folderDir(folder);
+        for (const QString &entry : folderDir.entryList(QDir::Files)) {
+            fileNames << folderDir.absoluteFilePath(entry);
         }
-        // Table headers
-        QList<QString> tableLabels = {"Position", "Action", "Time(s)", "Distance(pix)", "Speed(pix/ms)"};
-        eventsTable->setHorizontalHeaderLabels(tableLabels);
-        eventsTable->setMinimumSize(400, 600);
 
-        // updating storedEvents to reflect most recent loaded events tab + adding label, etc...
-        storedEvents.append(events);
-        QString tabName = "Brush " + QString::number(tabIdx);
-        tabWidget->addTab(eventsTable, tabName);
-        tabWidget->setHidden(false);
-        tabWidget->show();
-        ++tabCount;
+        QMutex candidatesMutex;
+        QtConcurrent::blockingMap(fileNames, [&](const QString &fileName) {
+            QList<Similarity::Candidate> found = Similarity::fileCandidates(fileName);
+            QMutexLocker locker(&candidatesMutex);
+            candidates << found;
+        });
     }
-    inFile.close();
 
-    // send signal to scribbler so that it canr redraw with tabs info from file and also adjust opacity with tabs on start
-    emit drawFromEvents(storedEvents);
-    emit adjustOpacity(tabWidget->currentIndex());
+    Similarity::rank(query, candidates);
+
+    // fill the panel, best match first
+    similarList->clear();
+    for (const Similarity::Candidate &candidate : candidates) {
+        QString distText = QString::number(candidate.distance, 'f', 3);
+        QListWidgetItem *item;
+        if (candidate.source.isEmpty()) {
+            item = new QListWidgetItem(QString("%1  (%2)").arg(tabWidget->tabText(candidate.brush), distText));
+            item->setData(Qt::UserRole, candidate.brush);
+        } else {
+            item = new QListWidgetItem(QString("%1: Brush %2  (%3)").arg(candidate.source).arg(candidate.brush).arg(distText));
+            item->setData(Qt::UserRole, -1);
+        }
+        similarList->addItem(item);
+    }
+    similarDock->setWindowTitle(QString("Similar to %1").arg(tabWidget->tabText(queryIdx)));
+    similarDock->show();
+    statusBar()->showMessage(QString("Compared %1 captures in %2 ms").arg(candidates.length()).arg(timer.elapsed()));
+}
+
+void MainWindow::similarActivated(QListWidgetItem *item) {
+    // captures from the session jump to their tab; ones from other files can't be shown here
+    int brush = item->data(Qt::UserRole).toInt();
+    if (brush >= 0 && brush < tabWidget->count()) {
+        tabWidget->setCurrentIndex(brush);
+    }
+}
+
+void MainWindow::streamEvents(bool enabled) {
+    if (!enabled) {
+        publisher->stop();
+        statusBar()->showMessage("Event streaming stopped");
+        return;
+    }
+
+    if (!publisher->start()) {
+        QMessageBox::information(this, "Error", "Can't open the local socket for event streaming. Is another Scribbler already streaming?");
+        QAction *streamAct = qobject_cast<QAction*>(sender());
+        if (streamAct) streamAct->setChecked(false);
+        return;
+    }
+    statusBar()->showMessage(QString("Streaming events on %1").arg(publisher->fullServerName()));
 }
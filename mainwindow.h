@@ -2,10 +2,13 @@
 #define MAINWINDOW_H
 
 #include "scribbler.h"
+#include "eventio.h"
+#include "capturepublisher.h"
 
 #include <QMainWindow>
 #include <QTableWidget>
 #include <QGraphicsScene>
+#include <QListWidget>
 
 class MainWindow : public QMainWindow
 {
@@ -13,14 +16,34 @@ class MainWindow : public QMainWindow
 
     QList<QList<MouseEvent*>*> storedEvents;
     QTabWidget *tabWidget;
+    QDockWidget *similarDock;
+    QListWidget *similarList;
+    CapturePublisher *publisher;
+    QMenu *recentMenu;
     QString dir;
     int tabCount;
 
+    QTableWidget *createEventsTable(QList<MouseEvent*> &events);
+    void exportFile(EventIO::Format format);
+    void loadTabs(QList<QList<MouseEvent*>*> &loaded);
+    void findSimilarIn(const QString &folder);
+    void loadFile(const QString &inFName);
+    void addRecentFile(const QString &fileName);
+    void updateRecentFiles();
+    static bool readOverview(const QString &fileName, ScribbleOverview &overview);
+
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
     void saveFile();
     void openFile();
+    void exportCsv();
+    void exportJson();
+    void importFile();
+    void findSimilar();
+    void findSimilarInFolder();
+    void similarActivated(QListWidgetItem *item);
+    void streamEvents(bool enabled);
     void changeTab();
     void itemSelectionChanged();
 
@@ -33,5 +56,6 @@ signals:
     void drawFromEvents(QList<QList<MouseEvent*>*> &storedEvents);
     void highlightScribble(int currentTabIdx, QPair<int, int> rowSlice, QList<QList<MouseEvent*>*> &storedEvents);
     void restoreColor();
+    void selectHeatmapCapture(QList<MouseEvent*> *events);
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,261 @@
+#include "overview.h"
+
+#include <QDataStream>
+#include <QPainter>
+#include <QtNumeric>
+
+#include <algorithm>
+#include <math.h>
+
+namespace {
+
+// simplification tolerance, as a fraction of the drawing's diagonal
+const qreal tolerance = 0.005;
+
+/* Ramer-Douglas-Peucker with an explicit stack, so long strokes can't overflow the call stack */
+QPolygonF simplify(const QPolygonF &stroke, qreal epsilon) {
+    int n = stroke.size();
+    if (n <= 2) return stroke;
+
+    QVector<bool> keep(n, false);
+    keep[0] = true;
+    keep[n - 1] = true;
+
+    QList<QPair<int, int>> ranges;
+    ranges.append(QPair<int, int>(0, n - 1));
+    while (!ranges.isEmpty()) {
+        QPair<int, int> range = ranges.takeLast();
+        QPointF a = stroke[range.first];
+        QPointF b = stroke[range.second];
+        QPointF ab = b - a;
+        qreal abLength = sqrt(ab.x() * ab.x() + ab.y() * ab.y());
+
+        // farthest point from the chord a-b
+        int farthest = -1;
+        qreal farthestDist = epsilon;
+        for (int i = range.first + 1; i < range.second; ++i) {
+            QPointF ap = stroke[i] - a;
+            qreal dist = (abLength > 0.0) ? fabs(ab.x() * ap.y() - ab.y() * ap.x()) / abLength : sqrt(ap.x() * ap.x() + ap.y() * ap.y());
+            if (dist > farthestDist) {
+                farthest = i;
+                farthestDist = dist;
+            }
+        }
+
+        if (farthest >= 0) {
+            keep[farthest] = true;
+            ranges.append(QPair<int, int>(range.first, farthest));
+            ranges.append(QPair<int, int>(farthest, range.second));
+        }
+    }
+
+    QPolygonF simplified;
+    for (int i = 0; i < n; ++i) {
+        if (keep[i]) simplified << stroke[i];
+    }
+    return simplified;
+}
+
+// evenly thins a stroke to at most maxPoints, always keeping both ends
+QPolygonF decimate(const QPolygonF &stroke, int maxPoints) {
+    int n = stroke.size();
+    maxPoints = qMax(maxPoints, 2);
+    if (n <= maxPoints) return stroke;
+
+    QPolygonF thinned;
+    for (int k = 0; k < maxPoints; ++k) {
+        thinned << stroke[(qint64)k * (n - 1) / (maxPoints - 1)];
+    }
+    return thinned;
+}
+
+/* Cuts strokes down to budget points in total. Bigger strokes keep their end points first; once
+ * those don't fit the smallest strokes are left out (emptied). What remains of the budget is
+ * shared by the kept strokes in proportion to the points simplification left them. */
+void fitBudget(QList<QPolygonF> &strokes, int budget) {
+    int pointCount = 0;
+    for (const QPolygonF &stroke : strokes) {
+        pointCount += stroke.size();
+    }
+    if (pointCount <= budget) return;
+
+    QVector<qreal> extent(strokes.size());
+    QVector<int> order(strokes.size());
+    for (int i = 0; i < strokes.size(); ++i) {
+        QRectF box = strokes[i].boundingRect();
+        extent[i] = box.width() + box.height();
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&extent](int a, int b) { return extent[a] > extent[b]; });
+
+    int reserved = 0;
+    int extraPoints = 0;
+    int kept = 0;
+    for (; kept < order.size(); ++kept) {
+        const QPolygonF &stroke = strokes[order[kept]];
+        int minimum = qMin((int)stroke.size(), 2);
+        if (reserved + minimum > budget) break;
+        reserved += minimum;
+        extraPoints += stroke.size() - minimum;
+    }
+    for (int k = kept; k < order.size(); ++k) {
+        strokes[order[k]].clear();
+    }
+
+    int spare = budget - reserved;
+    for (int k = 0; k < kept; ++k) {
+        QPolygonF &stroke = strokes[order[k]];
+        if (stroke.size() <= 2) continue;
+        stroke = decimate(stroke, 2 + (int)((qint64)(stroke.size() - 2) * spare / extraPoints));
+    }
+}
+
+}
+
+ScribbleOverview ScribbleOverview::build(const QList<QList<MouseEvent*>*> &storedEvents) {
+    ScribbleOverview overview;
+    if (storedEvents.isEmpty()) return overview;
+
+    // bounds first: the tolerance is relative to the whole drawing
+    QPointF topLeft(qInf(), qInf());
+    QPointF bottomRight(-qInf(), -qInf());
+    for (const QList<MouseEvent*> *events : storedEvents) {
+        for (const MouseEvent *event : *events) {
+            topLeft.setX(qMin(topLeft.x(), event->pos.x()));
+            topLeft.setY(qMin(topLeft.y(), event->pos.y()));
+            bottomRight.setX(qMax(bottomRight.x(), event->pos.x()));
+            bottomRight.setY(qMax(bottomRight.y(), event->pos.y()));
+        }
+    }
+    if (topLeft.x() <= bottomRight.x()) overview.bounds = QRectF(topLeft, bottomRight);
+    qreal diagonal = sqrt(overview.bounds.width() * overview.bounds.width() + overview.bounds.height() * overview.bounds.height());
+
+    // the budget is for the whole file, so strokes of every capture are gathered before it is spent
+    QList<QPolygonF> strokes;
+    QList<int> strokeCapture;
+
+    for (const QList<MouseEvent*> *events : storedEvents) {
+        CaptureOverview capture;
+        capture.eventsCount = events->length();
+        capture.pathLength = 0.0f;
+        capture.duration = events->isEmpty() ? 0 : events->last()->time - events->first()->time;
+
+        // every Press starts a new stroke
+        int firstStroke = strokes.length();
+        for (const MouseEvent *event : *events) {
+            if (event->action == MouseEvent::Press || strokes.length() == firstStroke) {
+                strokes.append(QPolygonF());
+                strokeCapture.append(overview.captures.length());
+            } else {
+                capture.pathLength += event->distance;
+            }
+            strokes.last() << event->pos;
+        }
+        overview.captures.append(capture);
+    }
+
+    for (QPolygonF &stroke : strokes) {
+        stroke = simplify(stroke, diagonal * tolerance);
+    }
+    fitBudget(strokes, pointBudget);
+
+    for (int i = 0; i < strokes.length(); ++i) {
+        if (!strokes[i].isEmpty()) overview.captures[strokeCapture[i]].strokes.append(strokes[i]);
+    }
+    return overview;
+}
+
+qint64 ScribbleOverview::eventsCount() const {
+    qint64 count = 0;
+    for (const CaptureOverview &capture : captures) {
+        count += capture.eventsCount;
+    }
+    return count;
+}
+
+QPixmap ScribbleOverview::thumbnail(QSize size) const {
+    QPixmap pixmap(size);
+    pixmap.fill(Qt::white);
+    if (captures.isEmpty()) return pixmap;
+
+    // fit bounds in the pixmap, keeping aspect ratio, with a small margin. Padded so a lone dot or straight line still has an area
+    QRectF area = bounds.adjusted(-1.0, -1.0, 1.0, 1.0);
+    QRectF target = QRectF(QPointF(0.0, 0.0), QSizeF(size)).adjusted(4.0, 4.0, -4.0, -4.0);
+    qreal scale = qMin(target.width() / area.width(), target.height() / area.height());
+
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.translate(target.center());
+    painter.scale(scale, scale);
+    painter.translate(-area.center());
+    painter.setPen(QPen(Qt::black, 0.0)); // cosmetic: 1 px whatever the scale
+
+    for (const CaptureOverview &capture : captures) {
+        for (const QPolygonF &stroke : capture.strokes) {
+            if (stroke.size() == 1) {
+                painter.drawPoint(stroke.first());
+            } else {
+                painter.drawPolyline(stroke);
+            }
+        }
+    }
+    return pixmap;
+}
+
+QString ScribbleOverview::summary() const {
+    float pathLength = 0.0f;
+    quint64 duration = 0;
+    for (const CaptureOverview &capture : captures) {
+        pathLength += capture.pathLength;
+        duration += capture.duration;
+    }
+    return QString("%1 brushes, %2 events\n%3 s drawing, %4 pix path")
+        .arg(captures.length())
+        .arg(eventsCount())
+        .arg(duration / 1000.0, 0, 'f', 1)
+        .arg(pathLength, 0, 'f', 0);
+}
+
+/* Points are stored as qint16 pairs: a thumbnail doesn't need sub-pixel positions */
+QDataStream &operator<<(QDataStream &out, const ScribbleOverview &overview) {
+    out << overview.bounds;
+    out << (int)overview.captures.length();
+    for (const CaptureOverview &capture : overview.captures) {
+        out << capture.eventsCount << capture.pathLength << capture.duration;
+        out << (quint16)capture.strokes.length();
+        for (const QPolygonF &stroke : capture.strokes) {
+            out << (quint16)stroke.size();
+            for (const QPointF &p : stroke) {
+                out << (qint16)qBound(-32768.0, round(p.x()), 32767.0) << (qint16)qBound(-32768.0, round(p.y()), 32767.0);
+            }
+        }
+    }
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, ScribbleOverview &overview) {
+    int capturesCount;
+    in >> overview.bounds >> capturesCount;
+    overview.captures.clear();
+
+    for (int c = 0; c < capturesCount && in.status() == QDataStream::Ok; ++c) {
+        CaptureOverview capture;
+        quint16 strokesCount;
+        in >> capture.eventsCount >> capture.pathLength >> capture.duration >> strokesCount;
+
+        for (int s = 0; s < strokesCount && in.status() == QDataStream::Ok; ++s) {
+            quint16 pointCount;
+            in >> pointCount;
+            QPolygonF stroke;
+            stroke.reserve(pointCount);
+            for (int i = 0; i < pointCount; ++i) {
+                qint16 x, y;
+                in >> x >> y;
+                stroke << QPointF(x, y);
+            }
+            capture.strokes.append(stroke);
+        }
+        overview.captures.append(capture);
+    }
+    return in;
+}
@@ -0,0 +1,37 @@
+#ifndef OVERVIEW_H
+#define OVERVIEW_H
+
+#include "scribbler.h"
+
+#include <QPixmap>
+#include <QPolygonF>
+
+/* Per capture summary kept in the header of a saved file: stats plus each stroke
+ * simplified to a handful of points, enough to draw a thumbnail without the events. */
+class CaptureOverview {
+public:
+    int eventsCount;
+    float pathLength;
+    quint64 duration;
+    QList<QPolygonF> strokes;
+};
+
+class ScribbleOverview {
+public:
+    // upper bound on outline points stored for a whole file, shared between its captures
+    static const int pointBudget = 1024;
+
+    QRectF bounds;
+    QList<CaptureOverview> captures;
+
+    static ScribbleOverview build(const QList<QList<MouseEvent*>*> &storedEvents);
+
+    qint64 eventsCount() const;
+    QPixmap thumbnail(QSize size) const;
+    QString summary() const;
+
+    friend QDataStream &operator<<(QDataStream &out, const ScribbleOverview &overview);
+    friend QDataStream &operator>>(QDataStream &in, ScribbleOverview &overview);
+};
+
+#endif // OVERVIEW_H
@@ -1,10 +1,11 @@
 #include "scribbler.h"
+#include "heatmap.h"
 
 #include <QtWidgets>
 #include <math.h>
 
-MouseEvent::MouseEvent(int _action, QPointF _pos, quint64 _time, float _distance, float _speed, QList<QGraphicsItem*> _graphicsItems)
-    : action(_action), pos(_pos), time(_time), distance(_distance), speed(_speed), graphicsItems(_graphicsItems) {}
+MouseEvent::MouseEvent(int _action, QPointF _pos, quint64 _time, float _distance, float _speed, QList<QGraphicsItem*> _graphicsItems, float _pressure)
+    : action(_action), pos(_pos), time(_time), distance(_distance), speed(_speed), pressure(_pressure), graphicsItems(_graphicsItems) {}
 
 QDataStream &operator<<(QDataStream &out, const MouseEvent &evt) {
     return out << evt.action << evt.pos << evt.time << evt.distance << evt.speed;
@@ -15,11 +16,25 @@ QDataStream &operator>>(QDataStream &in, MouseEvent &evt) {
 }
 
 /* ============================= SCRIBBLER ================================ */
+namespace {
+
+const QRectF canvasRect(0.0, 0.0, 800.0, 600.0);
+
+// scene pixels per heatmap cell
+const int heatmapCellSize = 4;
+
+// touch point ids and stylus ids come from different devices; keep their lane keys apart
+const quint64 tabletContactBit = Q_UINT64_C(1) << 32;
+
+}
+
 Scribbler::Scribbler()
-    :lineWidth(4.0), isDots(false) {
+    :lineWidth(4.0), isDots(false), isHeatmap(false), heatmapBySpeed(false), heatmapSelectedOnly(false),
+    allHeatmap(new Heatmap(canvasRect, heatmapCellSize)), selectedHeatmap(new Heatmap(canvasRect, heatmapCellSize)),
+    selectedEvents(nullptr), heatmapItem(nullptr) {
 
     setScene(&scene);
-    setSceneRect(QRectF(0.0, 0.0, 800.0, 600.0));
+    setSceneRect(canvasRect);
     setMinimumSize(QSize(600, 600));
     setRenderHint(QPainter::Antialiasing, true);
     setBackgroundBrush(Qt::white);
@@ -28,6 +43,14 @@ Scribbler::Scribbler()
     // We store dots and lines in graphicsGroup in a list for corresponding capture.
     graphicsGroup = new QGraphicsItemGroup();
     scene.addItem(graphicsGroup);
+
+    // Touch panels deliver QTouchEvents to the viewport only when asked to. viewportEvent keeps only touchscreen ones
+    viewport()->setAttribute(Qt::WA_AcceptTouchEvents, true);
+}
+
+Scribbler::~Scribbler() {
+    delete allHeatmap;
+    delete selectedHeatmap;
 }
 
 void Scribbler::mouseMoveEvent(QMouseEvent *evt) {
@@ -59,7 +82,9 @@ void Scribbler::mouseMoveEvent(QMouseEvent *evt) {
     speed = distance / timeDiff;
     prevTimestamp = evt->timestamp();
 
-    events << new MouseEvent(MouseEvent::Move, p, evt->timestamp(), distance, speed, QList<QGraphicsItem*>{dot, line});
+    MouseEvent *event = new MouseEvent(MouseEvent::Move, p, evt->timestamp(), distance, speed, QList<QGraphicsItem*>{dot, line});
+    events << event;
+    emit eventCaptured(*event);
 }
 
 void Scribbler::mousePressEvent(QMouseEvent *evt) {
@@ -78,7 +103,9 @@ void Scribbler::mousePressEvent(QMouseEvent *evt) {
     speed = 0.0;
     prevTimestamp = evt->timestamp();
 
-    events << new MouseEvent(MouseEvent::Press, p, evt->timestamp(), distance, speed, QList<QGraphicsItem*>{dot});
+    MouseEvent *event = new MouseEvent(MouseEvent::Press, p, evt->timestamp(), distance, speed, QList<QGraphicsItem*>{dot});
+    events << event;
+    emit eventCaptured(*event);
 }
 
 void Scribbler::mouseReleaseEvent(QMouseEvent *evt) {
@@ -89,12 +116,15 @@ void Scribbler::mouseReleaseEvent(QMouseEvent *evt) {
     if (timeDiff == 0) timeDiff = 1; //prevent zero division
     speed = distance / timeDiff;
 
-    events << new MouseEvent(MouseEvent::Release, p, evt->timestamp(), distance, speed, QList<QGraphicsItem*>{});
+    MouseEvent *event = new MouseEvent(MouseEvent::Release, p, evt->timestamp(), distance, speed, QList<QGraphicsItem*>{});
+    events << event;
+    emit eventCaptured(*event);
 }
 
 void Scribbler::restoreColor() {
+    // widths are kept: lines drawn with a pen or on touch follow pressure
     for (QGraphicsLineItem *line : lines) {
-        line->setPen(QPen(Qt::black, lineWidth, Qt::SolidLine, Qt::FlatCap));
+        line->setPen(QPen(Qt::black, line->pen().widthF(), Qt::SolidLine, Qt::FlatCap));
     }
 
     for (QGraphicsEllipseItem *dot : dots) {
@@ -131,7 +161,7 @@ void Scribbler::highlightScribble(int currentTabIdx, QPair<int, int> rowSlice, Q
                 }
                 else if (graphicsItem->type() == QGraphicsLineItem::Type) {
                     QGraphicsLineItem *line = (QGraphicsLineItem*)graphicsItem;
-                    line->setPen(QPen(color, lineWidth, Qt::SolidLine, Qt::FlatCap));
+                    line->setPen(QPen(color, line->pen().widthF(), Qt::SolidLine, Qt::FlatCap));
                 }
             }
         }
@@ -152,12 +182,16 @@ void Scribbler::adjustOpacity(int currentTabIdx) {
 void Scribbler::resetScribbler() {
     events.clear();
     scene.clear();
+    heatmapItem = nullptr;
+    resetLanes(true);
+    allHeatmap->clear();
     dots.clear();
     lines.clear();
     showLines();
     graphicsGroups.clear();
     graphicsGroup = new QGraphicsItemGroup();
     scene.addItem(graphicsGroup);
+    emit captureReset();
     emit resetFile();
 }
 
@@ -179,23 +213,44 @@ void Scribbler::resetCapture() {
     graphicsGroup = new QGraphicsItemGroup();
     scene.addItem(graphicsGroup);
     events.clear();
+    resetLanes(false);
+    emit captureReset();
 }
 
-/* One endCapture, scribbler sends data and clear QList<MouseEvent> */
+/* One endCapture, scribbler sends data and clear QList<MouseEvent>. Each touch/tablet lane with samples gets its own tab too */
 void Scribbler::endCapture() {
-    // don't capture for empty graphicsGroup
-    if (events.isEmpty()) return;
+    bool committed = false;
 
-    // reset graphicsGroup for new capture
-    graphicsGroups.append(graphicsGroup);
-    graphicsGroup = new QGraphicsItemGroup();
-    scene.addItem(graphicsGroup);
-    emit addTab(events);
-    events.clear();
+    if (!events.isEmpty()) {
+        // only the newly committed capture is binned into the heatmap
+        allHeatmap->accumulate(events);
+
+        // reset graphicsGroup for new capture
+        graphicsGroups.append(graphicsGroup);
+        if (isHeatmap) graphicsGroup->setVisible(false);
+        graphicsGroup = new QGraphicsItemGroup();
+        scene.addItem(graphicsGroup);
+        emit addTab(events);
+        events.clear();
+        committed = true;
+    }
+
+    for (CaptureLane &lane : lanes) {
+        if (lane.samples.isEmpty()) continue;
+        commitLane(lane);
+        committed = true;
+    }
+
+    // don't capture for empty graphicsGroup
+    if (!committed) return;
+    emit captureCommitted();
+    renderHeatmap();
 }
 
 void Scribbler::showDots() {
     isDots = true;
+    isHeatmap = false;
+    setStrokesVisible(true);
 
     for (int i = 0; i < lines.length(); ++i) {
         QGraphicsLineItem *line = lines[i];
@@ -205,6 +260,8 @@ void Scribbler::showDots() {
 
 void Scribbler::showLines() {
     isDots = false;
+    isHeatmap = false;
+    setStrokesVisible(true);
 
     for (int i = 0; i < lines.length(); ++i) {
         QGraphicsLineItem *line = lines[i];
@@ -213,13 +270,23 @@ void Scribbler::showLines() {
 }
 
 void Scribbler::drawFromEvents(QList<QList<MouseEvent*>*> &storedEvents) {
+    // an uncommitted capture is thrown away below; subscribers have seen its samples and must be told
+    bool discarding = !events.isEmpty();
+    for (const CaptureLane &lane : lanes) {
+        if (!lane.samples.isEmpty()) discarding = true;
+    }
+
     // reset before redrawing after loading old file or dealing with opacity
     events.clear();
     scene.clear();
+    heatmapItem = nullptr;
+    resetLanes(true);
+    allHeatmap->clear();
     dots.clear();
     lines.clear();
     graphicsGroups.clear();
     showLines(); //DO I WANT TO RESET VIEW DOTS/LINES MODE WHEN OPENING FILE?
+    if (discarding) emit captureReset();
 
     // Nothing to draw
     if (storedEvents.isEmpty()) return;
@@ -232,54 +299,256 @@ void Scribbler::drawFromEvents(QList<QList<MouseEvent*>*> &storedEvents) {
         graphicsGroup = new QGraphicsItemGroup();
         scene.addItem(graphicsGroup);
 
-        // deal with event in given events of a tab
+        // deal with event in given events of a tab. Press actions add only dot. Move creates lines too
         for (int eventIdx = 0; eventIdx < events->length(); ++eventIdx) {
             MouseEvent *event = events->at(eventIdx);
-            QPointF p = event->pos;
-
-            // Press actions add only dot. Move creates lines too
-            switch (event->action) {
-                case MouseEvent::Press: {
-                    lastPoint = p;
-
-                    // dots of Press
-                    QGraphicsEllipseItem *dot = new QGraphicsEllipseItem(QRectF(p - QPointF(0.5*lineWidth, 0.5*lineWidth), QSizeF(lineWidth, lineWidth)));
-                    dot->setPen(Qt::NoPen);
-                    dot->setBrush(Qt::black);
-
-                    dots.append(dot);
-                    graphicsGroup->addToGroup(dot);
-                    event->graphicsItems.append(dot);
-                    break;
-                }
-                case MouseEvent::Move: {
-                    // lines of Move
-                    QGraphicsLineItem *line = new QGraphicsLineItem(QLineF(lastPoint, p));
-                    line->setPen(QPen(Qt::black, lineWidth, Qt::SolidLine, Qt::FlatCap));
-
-                    lines.append(line);
-                    graphicsGroup->addToGroup(line);
-
-                    // dots of Move
-                    QGraphicsEllipseItem *dot = new QGraphicsEllipseItem(QRectF(p - QPointF(0.5*lineWidth, 0.5*lineWidth), QSizeF(lineWidth, lineWidth)));
-                    dot->setPen(Qt::NoPen);
-                    dot->setBrush(Qt::black);
-
-                    dots.append(dot);
-                    graphicsGroup->addToGroup(dot);
-                    event->graphicsItems.append(dot);
-                    event->graphicsItems.append(line);
-                    lastPoint = p;
-                    break;
-                }
-                case MouseEvent::Release: {
-                    break;
-                }
-            }
+            drawEvent(event, lastPoint, graphicsGroup);
+            if (event->action != MouseEvent::Release) lastPoint = event->pos;
         }
         graphicsGroups.append(graphicsGroup);
     }
+    allHeatmap->accumulateAll(storedEvents);
+
     // new graphicsGroup to prevent new modifications of file from being included in previous modifications
     graphicsGroup = new QGraphicsItemGroup();
     scene.addItem(graphicsGroup);
 }
+
+/* Committed strokes are hidden while the heatmap shows; the capture in progress stays visible */
+void Scribbler::setStrokesVisible(bool visible) {
+    for (QGraphicsItemGroup *group : graphicsGroups) {
+        group->setVisible(visible);
+    }
+    if (heatmapItem) heatmapItem->setVisible(!visible);
+}
+
+void Scribbler::showHeatmap() {
+    isHeatmap = true;
+    setStrokesVisible(false);
+    renderHeatmap();
+}
+
+void Scribbler::setHeatmapBySpeed(bool bySpeed) {
+    heatmapBySpeed = bySpeed;
+    renderHeatmap();
+}
+
+void Scribbler::setHeatmapSelectedOnly(bool selectedOnly) {
+    heatmapSelectedOnly = selectedOnly;
+    rebuildSelectedHeatmap();
+    renderHeatmap();
+}
+
+void Scribbler::selectHeatmapCapture(QList<MouseEvent*> *events) {
+    selectedEvents = events;
+    if (!heatmapSelectedOnly) return;
+    rebuildSelectedHeatmap();
+    renderHeatmap();
+}
+
+// the selected grid is only kept up to date while the heatmap is limited to it
+void Scribbler::rebuildSelectedHeatmap() {
+    if (!heatmapSelectedOnly) return;
+    selectedHeatmap->clear();
+    if (selectedEvents) selectedHeatmap->accumulate(*selectedEvents);
+}
+
+/* Whole grid goes to the scene as one pixmap, scaled up from one pixel per cell */
+void Scribbler::renderHeatmap() {
+    if (!isHeatmap) return;
+
+    Heatmap *heatmap = heatmapSelectedOnly ? selectedHeatmap : allHeatmap;
+    QImage image = heatmap->toImage(heatmapBySpeed ? Heatmap::Speed : Heatmap::Dwell);
+
+    if (!heatmapItem) {
+        heatmapItem = new QGraphicsPixmapItem();
+        heatmapItem->setTransformationMode(Qt::SmoothTransformation);
+        heatmapItem->setScale(heatmap->cellSize());
+        heatmapItem->setPos(heatmap->origin());
+        heatmapItem->setZValue(-1.0); // under the capture in progress
+        scene.addItem(heatmapItem);
+    }
+    heatmapItem->setPixmap(QPixmap::fromImage(image));
+    heatmapItem->setVisible(true);
+}
+
+/* Scene items for one recorded event, added to group: a dot, plus a line from the previous point for Move */
+void Scribbler::drawEvent(MouseEvent *event, QPointF from, QGraphicsItemGroup *group) {
+    if (event->action == MouseEvent::Release) return;
+
+    QPointF p = event->pos;
+    double width = lineWidth * event->pressure;
+
+    // lines of Move
+    if (event->action == MouseEvent::Move) {
+        QGraphicsLineItem *line = new QGraphicsLineItem(QLineF(from, p));
+        line->setPen(QPen(Qt::black, width, Qt::SolidLine, Qt::FlatCap));
+        if (isDots) line->setVisible(false);
+
+        lines.append(line);
+        group->addToGroup(line);
+        event->graphicsItems.append(line);
+    }
+
+    // dots of Press and Move
+    QGraphicsEllipseItem *dot = new QGraphicsEllipseItem(QRectF(p - QPointF(0.5*width, 0.5*width), QSizeF(width, width)));
+    dot->setPen(Qt::NoPen);
+    dot->setBrush(Qt::black);
+
+    dots.append(dot);
+    group->addToGroup(dot);
+    event->graphicsItems.prepend(dot);
+}
+
+/* ======================= TOUCH AND TABLET LANES ========================= */
+bool Scribbler::viewportEvent(QEvent *evt) {
+    switch (evt->type()) {
+        case QEvent::TouchBegin:
+        case QEvent::TouchUpdate:
+        case QEvent::TouchEnd:
+        case QEvent::TouchCancel: {
+            // touchpad contacts aren't screen positions; those stay with the default handling
+            QTouchEvent *touch = static_cast<QTouchEvent*>(evt);
+            if (touch->device()->type() != QInputDevice::DeviceType::TouchScreen) break;
+
+            // accepting stops Qt from also synthesizing mouse events for the primary contact
+            touchContacts(touch);
+            evt->accept();
+            return true;
+        }
+        case QEvent::TabletPress:
+        case QEvent::TabletMove:
+        case QEvent::TabletRelease:
+            tabletContact(static_cast<QTabletEvent*>(evt));
+            evt->accept();
+            return true;
+        default:
+            break;
+    }
+    return QGraphicsView::viewportEvent(evt);
+}
+
+CaptureLane *Scribbler::laneFor(quint64 contactKey) {
+    for (CaptureLane &lane : lanes) {
+        if (lane.active && lane.contactKey == contactKey) return &lane;
+    }
+    return nullptr;
+}
+
+/* New contacts take the lowest free slot, so one finger drawing stroke after stroke stays in one lane */
+CaptureLane *Scribbler::pressLane(quint64 contactKey) {
+    for (CaptureLane &lane : lanes) {
+        if (lane.active) continue;
+        if (!lane.preview) {
+            lane.preview = new LanePreview(lane, sceneRect(), lineWidth);
+            scene.addItem(lane.preview);
+        }
+        // first use of this slot: the one allocation, here rather than per sample
+        lane.reserve();
+        lane.contactKey = contactKey;
+        return &lane;
+    }
+    return nullptr; // more contacts than lanes: the extra ones are ignored
+}
+
+void Scribbler::touchContacts(QTouchEvent *evt) {
+    QTransform toScene = viewportTransform().inverted();
+    quint64 time = evt->timestamp();
+
+    // Qt6 sends TouchCancel with no points, so every touch lane still down is ended where it last was
+    if (evt->type() == QEvent::TouchCancel) {
+        for (CaptureLane &lane : lanes) {
+            if (!lane.active || (lane.contactKey & tabletContactBit)) continue;
+            float pressure = lane.samples.isEmpty() ? 1.0f : lane.samples.last().pressure;
+            lane.release(lane.lastPoint, time, pressure);
+            laneSampleRecorded(lane);
+        }
+        return;
+    }
+
+    for (const QEventPoint &point : evt->points()) {
+        quint64 contactKey = (quint32)point.id();
+        QPointF p = toScene.map(point.position());
+        float pressure = point.pressure();
+
+        if (point.state() == QEventPoint::Pressed) {
+            CaptureLane *lane = pressLane(contactKey);
+            if (lane && lane->press(contactKey, p, time, pressure)) laneSampleRecorded(*lane);
+            continue;
+        }
+
+        CaptureLane *lane = laneFor(contactKey);
+        if (!lane) continue;
+
+        if (point.state() == QEventPoint::Released) {
+            lane->release(p, time, pressure);
+            laneSampleRecorded(*lane);
+        } else if (point.state() == QEventPoint::Updated) {
+            if (lane->move(p, time, pressure)) laneSampleRecorded(*lane);
+        }
+    }
+}
+
+void Scribbler::tabletContact(QTabletEvent *evt) {
+    quint64 contactKey = tabletContactBit | (quint32)evt->points().first().id();
+    QPointF p = viewportTransform().inverted().map(evt->position());
+    quint64 time = evt->timestamp();
+    float pressure = evt->pressure();
+
+    if (evt->type() == QEvent::TabletPress) {
+        CaptureLane *lane = pressLane(contactKey);
+        if (lane && lane->press(contactKey, p, time, pressure)) laneSampleRecorded(*lane);
+        return;
+    }
+
+    // hover moves arrive with no lane: the stylus isn't touching
+    CaptureLane *lane = laneFor(contactKey);
+    if (!lane) return;
+
+    if (evt->type() == QEvent::TabletRelease) {
+        lane->release(p, time, pressure);
+        laneSampleRecorded(*lane);
+    } else {
+        if (lane->move(p, time, pressure)) laneSampleRecorded(*lane);
+    }
+}
+
+// lanes are numbered by slot, so a subscriber can tell simultaneous contacts apart
+void Scribbler::laneSampleRecorded(CaptureLane &lane) {
+    emit laneSampleCaptured((int)(&lane - lanes), lane.samples.last());
+}
+
+/* Off the hot path: a lane's samples become MouseEvents and scene items, and go to a tab of their own */
+void Scribbler::commitLane(CaptureLane &lane) {
+    QList<MouseEvent*> laneEvents;
+    laneEvents.reserve(lane.samples.size());
+
+    QGraphicsItemGroup *group = new QGraphicsItemGroup();
+    scene.addItem(group);
+
+    // a lane committed while its contact stayed down resumes with a Move, so start from its own first point
+    QPointF from = lane.samples.first().pos;
+    for (const LaneSample &sample : lane.samples) {
+        MouseEvent *event = new MouseEvent(sample.action, sample.pos, sample.time, sample.distance, sample.speed, QList<QGraphicsItem*>{}, sample.pressure);
+        drawEvent(event, from, group);
+        if (sample.action != MouseEvent::Release) from = sample.pos;
+        laneEvents << event;
+    }
+
+    allHeatmap->accumulate(laneEvents);
+    graphicsGroups.append(group);
+    if (isHeatmap) group->setVisible(false);
+
+    // a contact still down keeps its lane; its next samples start the next capture
+    lane.clear();
+    emit addTab(laneEvents);
+}
+
+/* Drops uncommitted lane samples. After scene.clear() the previews are gone too */
+void Scribbler::resetLanes(bool sceneCleared) {
+    for (CaptureLane &lane : lanes) {
+        if (sceneCleared) lane.preview = nullptr;
+        lane.active = false;
+        lane.clear();
+    }
+}
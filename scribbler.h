@@ -1,9 +1,16 @@
 #ifndef SCRIBBLER_H
 #define SCRIBBLER_H
 
+#include "capturelane.h"
+
 #include <QGraphicsView>
+#include <QGraphicsPixmapItem>
 #include <QTableWidget>
 
+class Heatmap;
+class QTouchEvent;
+class QTabletEvent;
+
 class MouseEvent {
 public:
     enum {
@@ -19,9 +26,10 @@ public:
     quint64 time;
     float distance;
     float speed;
+    float pressure;
     QList<QGraphicsItem*> graphicsItems;
 
-    MouseEvent(int _action, QPointF _pos, quint64 _time, float _distance, float _speed, QList<QGraphicsItem*> _graphicsItems);
+    MouseEvent(int _action, QPointF _pos, quint64 _time, float _distance, float _speed, QList<QGraphicsItem*> _graphicsItems, float _pressure = 1.0f);
 
     friend QDataStream &operator<<(QDataStream &out, const MouseEvent &evt);
     friend QDataStream &operator>>(QDataStream &in, const MouseEvent &evt);
@@ -43,10 +51,37 @@ class Scribbler : public QGraphicsView
     QList<QGraphicsItemGroup*> graphicsGroups;
     QGraphicsItemGroup *graphicsGroup;
 
+    // heatmap view: committed captures binned incrementally, plus the selected one on demand
+    bool isHeatmap;
+    bool heatmapBySpeed;
+    bool heatmapSelectedOnly;
+    Heatmap *allHeatmap;
+    Heatmap *selectedHeatmap;
+    QList<MouseEvent*> *selectedEvents;
+    QGraphicsPixmapItem *heatmapItem;
+
+    void setStrokesVisible(bool visible);
+    void renderHeatmap();
+    void rebuildSelectedHeatmap();
+
+    // touch and tablet: one lane per simultaneous contact, committed to a tab each by endCapture
+    static const int maxLanes = 16;
+    CaptureLane lanes[maxLanes];
+
+    CaptureLane *laneFor(quint64 contactKey);
+    CaptureLane *pressLane(quint64 contactKey);
+    void touchContacts(QTouchEvent *evt);
+    void tabletContact(QTabletEvent *evt);
+    void laneSampleRecorded(CaptureLane &lane);
+    void commitLane(CaptureLane &lane);
+    void resetLanes(bool sceneCleared);
+    void drawEvent(MouseEvent *event, QPointF from, QGraphicsItemGroup *group);
+
     Q_OBJECT
 
 public:
     Scribbler();
+    ~Scribbler();
 
     void resetScribbler();
 
@@ -55,21 +90,32 @@ public:
 
     void showLines();
     void showDots();
+    void showHeatmap();
 
 public slots:
     void drawFromEvents(QList<QList<MouseEvent*>*> &storedEvents);
     void adjustOpacity(int currentTabIdx);
     void highlightScribble(int currentTabIdx, QPair<int, int> rowSlice, QList<QList<MouseEvent*>*> &storedEvents);
     void restoreColor();
+    void setHeatmapBySpeed(bool bySpeed);
+    void setHeatmapSelectedOnly(bool selectedOnly);
+    void selectHeatmapCapture(QList<MouseEvent*> *events);
 
 protected:
     void mouseMoveEvent(QMouseEvent *evt) override;
     void mousePressEvent(QMouseEvent *evt) override;
     void mouseReleaseEvent(QMouseEvent *evt) override;
+    bool viewportEvent(QEvent *evt) override;
 
 signals:
     void addTab(QList<MouseEvent*> &events);
     void resetFile();
+
+    // live stream of what the mouse handlers and touch/tablet lanes record, for CapturePublisher
+    void eventCaptured(const MouseEvent &event);
+    void laneSampleCaptured(int lane, const LaneSample &sample);
+    void captureCommitted();
+    void captureReset();
 };
 
 #endif // SCRIBBLER_H
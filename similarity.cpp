@@ -0,0 +1,147 @@
+#include "similarity.h"
+#include "eventio.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+namespace {
+
+// how much a difference in normalized speed counts against a difference in normalized position
+const float speedWeight = 0.25f;
+
+const float infinity = std::numeric_limits<float>::infinity();
+
+}
+
+Similarity::Signature Similarity::signature(const QList<MouseEvent*> &events) {
+    Signature sig;
+    sig.valid = !events.isEmpty();
+    if (!sig.valid) return sig;
+
+    // cumulative path length along the capture, pen-up jumps between strokes included
+    int n = events.length();
+    QVector<float> arcLength(n);
+    arcLength[0] = 0.0f;
+    for (int i = 1; i < n; ++i) {
+        QPointF d = events[i]->pos - events[i - 1]->pos;
+        arcLength[i] = arcLength[i - 1] + sqrt(d.x() * d.x() + d.y() * d.y());
+    }
+    float total = arcLength[n - 1];
+
+    // resample to signatureLength points spaced evenly along the path
+    int seg = 0;
+    for (int k = 0; k < signatureLength; ++k) {
+        float target = total * k / (signatureLength - 1);
+        while (seg < n - 2 && arcLength[seg + 1] < target) ++seg;
+
+        int next = qMin(seg + 1, n - 1);
+        float segLength = arcLength[next] - arcLength[seg];
+        float t = (segLength > 0.0f) ? qBound(0.0f, (target - arcLength[seg]) / segLength, 1.0f) : 0.0f;
+
+        const MouseEvent *a = events[seg];
+        const MouseEvent *b = events[next];
+        sig.x[k] = a->pos.x() + t * (b->pos.x() - a->pos.x());
+        sig.y[k] = a->pos.y() + t * (b->pos.y() - a->pos.y());
+        sig.speed[k] = a->speed + t * (b->speed - a->speed);
+    }
+
+    // translation, scale and speed invariance: center on centroid, divide by RMS radius and mean speed
+    float cx = 0.0f, cy = 0.0f, meanSpeed = 0.0f;
+    for (int k = 0; k < signatureLength; ++k) {
+        cx += sig.x[k];
+        cy += sig.y[k];
+        meanSpeed += sig.speed[k];
+    }
+    cx /= signatureLength;
+    cy /= signatureLength;
+    meanSpeed /= signatureLength;
+
+    float radius = 0.0f;
+    for (int k = 0; k < signatureLength; ++k) {
+        sig.x[k] -= cx;
+        sig.y[k] -= cy;
+        radius += sig.x[k] * sig.x[k] + sig.y[k] * sig.y[k];
+    }
+    radius = sqrt(radius / signatureLength);
+
+    float posScale = (radius > 1e-6f) ? 1.0f / radius : 1.0f;
+    float speedScale = (meanSpeed > 1e-6f) ? 1.0f / meanSpeed : 1.0f;
+    for (int k = 0; k < signatureLength; ++k) {
+        sig.x[k] *= posScale;
+        sig.y[k] *= posScale;
+        sig.speed[k] *= speedScale;
+    }
+    return sig;
+}
+
+QList<Similarity::Candidate> Similarity::fileCandidates(const QString &fileName) {
+    QList<Candidate> candidates;
+
+    QFile inFile(fileName);
+    if (!inFile.open(QIODevice::ReadOnly)) return candidates;
+
+    QList<QList<MouseEvent*>*> loaded;
+    if (!EventIO::readScribbleFile(inFile, loaded)) return candidates;
+
+    // only the signatures are kept, the events are thrown away again
+    for (int brush = 0; brush < loaded.length(); ++brush) {
+        candidates.append({QFileInfo(fileName).fileName(), brush, signature(*loaded[brush]), 0.0f});
+        qDeleteAll(*loaded[brush]);
+        delete loaded[brush];
+    }
+    return candidates;
+}
+
+/* Banded DTW. Per row, the local costs and the min over the previous row are computed in
+ * straight loops over contiguous floats the compiler vectorizes; only the dependency on
+ * the cell to the left is left to a short scalar sweep. */
+float Similarity::dtwDistance(const Signature &a, const Signature &b) {
+    const int n = signatureLength;
+    float prevRow[n + 1];
+    float curRow[n + 1];
+    float cost[n + 1];
+    float diag[n + 1];
+
+    std::fill(prevRow, prevRow + n + 1, infinity);
+    prevRow[0] = 0.0f;
+
+    for (int i = 1; i <= n; ++i) {
+        int lo = qMax(1, i - bandRadius);
+        int hi = qMin(n, i + bandRadius);
+
+        std::fill(curRow, curRow + n + 1, infinity);
+
+        float ax = a.x[i - 1];
+        float ay = a.y[i - 1];
+        float as = a.speed[i - 1];
+        for (int j = lo; j <= hi; ++j) {
+            float dx = ax - b.x[j - 1];
+            float dy = ay - b.y[j - 1];
+            float ds = as - b.speed[j - 1];
+            cost[j] = dx * dx + dy * dy + speedWeight * ds * ds;
+        }
+        for (int j = lo; j <= hi; ++j) {
+            diag[j] = std::min(prevRow[j], prevRow[j - 1]);
+        }
+        for (int j = lo; j <= hi; ++j) {
+            curRow[j] = cost[j] + std::min(diag[j], curRow[j - 1]);
+        }
+        std::copy(curRow, curRow + n + 1, prevRow);
+    }
+    return prevRow[n] / n;
+}
+
+void Similarity::rank(const Signature &query, QList<Candidate> &candidates) {
+    QtConcurrent::blockingMap(candidates, [&query](Candidate &candidate) {
+        candidate.distance = candidate.signature.valid ? dtwDistance(query, candidate.signature) : infinity;
+    });
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.distance < b.distance;
+    });
+}
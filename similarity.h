@@ -0,0 +1,43 @@
+#ifndef SIMILARITY_H
+#define SIMILARITY_H
+
+#include "scribbler.h"
+
+#include <QString>
+
+/* Capture similarity by Dynamic Time Warping. Every capture is reduced once to a
+ * fixed length Signature (arc length resampled, centered, scale and speed normalized)
+ * so comparing two captures costs the same no matter how many events they hold. */
+namespace Similarity {
+
+// Points per signature and Sakoe-Chiba band half width used by dtwDistance
+constexpr int signatureLength = 64;
+constexpr int bandRadius = 8;
+
+struct Signature {
+    float x[signatureLength];
+    float y[signatureLength];
+    float speed[signatureLength];
+    bool valid;
+};
+
+struct Candidate {
+    QString source; // file name, empty for captures in the current session
+    int brush;      // tab index in the session or in source
+    Signature signature;
+    float distance;
+};
+
+Signature signature(const QList<MouseEvent*> &events);
+
+// Signatures for every capture in a saved scribble file, empty if it isn't one
+QList<Candidate> fileCandidates(const QString &fileName);
+
+float dtwDistance(const Signature &a, const Signature &b);
+
+// Scores every candidate against query on the global QThreadPool, then sorts them most similar first
+void rank(const Signature &query, QList<Candidate> &candidates);
+
+}
+
+#endif // SIMILARITY_H
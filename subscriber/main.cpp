@@ -0,0 +1,101 @@
+#include <QCoreApplication>
+#include <QLocalSocket>
+#include <QTextStream>
+#include <QtEndian>
+
+#include <string.h>
+
+/* Connects to the socket opened by Scribbler's CapturePublisher and prints every frame.
+ * See capturepublisher.h for the wire format. Usage: subscriber [serverName] */
+
+namespace {
+
+const int headerSize = 1 + 4;
+const int sampleSize = 1 + 1 + 4 + 4 + 8 + 4 + 4;
+
+float getFloat(const char *in) {
+    quint32 bits = qFromLittleEndian<quint32>(in);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+const char *actionName(quint8 action) {
+    switch (action) {
+        case 0:
+            return "Press";
+        case 1:
+            return "Move";
+        case 2:
+            return "Release";
+    }
+    return "Unknown";
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QString serverName = (argc > 1) ? QString(argv[1]) : QString("scribbler-events");
+    QTextStream out(stdout);
+
+    QLocalSocket socket;
+    QByteArray pending;
+
+    QObject::connect(&socket, &QLocalSocket::readyRead, [&]() {
+        pending += socket.readAll();
+
+        // handle every complete frame, keep a partial one for the next read
+        int offset = 0;
+        while (pending.size() - offset >= headerSize) {
+            const char *frame = pending.constData() + offset;
+            quint8 type = (quint8)frame[0];
+            quint32 payloadLength = qFromLittleEndian<quint32>(frame + 1);
+            if (pending.size() - offset < headerSize + (qint64)payloadLength) break;
+
+            const char *payload = frame + headerSize;
+            switch (type) {
+                case 1: {
+                    quint32 dropped = qFromLittleEndian<quint32>(payload);
+                    quint16 count = qFromLittleEndian<quint16>(payload + 4);
+                    out << "samples " << count << " dropped " << dropped << "\n";
+
+                    const char *sample = payload + 6;
+                    for (int i = 0; i < count; ++i, sample += sampleSize) {
+                        // contact 0 is the mouse, 1 + n touch/tablet lane n
+                        out << "  " << actionName((quint8)sample[0])
+                            << " contact=" << (int)(quint8)sample[1]
+                            << " (" << getFloat(sample + 2) << ", " << getFloat(sample + 6) << ")"
+                            << " t=" << qFromLittleEndian<quint64>(sample + 10)
+                            << " dist=" << getFloat(sample + 18)
+                            << " speed=" << getFloat(sample + 22) << "\n";
+                    }
+                    break;
+                }
+                case 2:
+                    out << "commit\n";
+                    break;
+                case 3:
+                    out << "reset\n";
+                    break;
+                default:
+                    out << "unknown frame " << (int)type << "\n";
+                    break;
+            }
+            offset += headerSize + payloadLength;
+        }
+        pending.remove(0, offset);
+        out.flush();
+    });
+
+    QObject::connect(&socket, &QLocalSocket::disconnected, &a, &QCoreApplication::quit);
+    QObject::connect(&socket, &QLocalSocket::errorOccurred, [&](QLocalSocket::LocalSocketError) {
+        out << "error: " << socket.errorString() << "\n";
+        out.flush();
+        a.exit(1);
+    });
+
+    socket.connectToServer(serverName);
+    return a.exec();
+}
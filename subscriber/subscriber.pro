@@ -0,0 +1,10 @@
+QT       += core network
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# Small test client for the event stream published by Scribbler (Capture > Stream events to local socket)
+
+SOURCES += \
+    main.cpp